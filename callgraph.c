@@ -0,0 +1,176 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stddef.h>
+
+#include "callgraph.h"
+#include "message.h"
+#include "memory.h"
+
+static int callgraph_address_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int callgraph_edge_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Returns the index of the last node whose address is lower or equal to the specified one, or -1. */
+static ptrdiff_t callgraph_node_find(const callgraph_t *graph, uint32_t address) {
+    size_t first = 0, last = graph->node_count;
+    while(first < last) {
+        size_t middle = first + (last - first) / 2;
+        if(graph->node[middle] <= address) {
+            first = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    return (ptrdiff_t)first - 1;
+}
+
+static void callgraph_release_edges(callgraph_t *graph) {
+    free(graph->row);
+    free(graph->column);
+    free(graph->weight);
+    free(graph->callers);
+    free(graph->calls);
+    graph->row = graph->column = graph->weight = graph->callers = graph->calls = NULL;
+    graph->edge_count = 0;
+}
+
+/* Initializes call graph. */
+void callgraph_init(callgraph_t *graph) {
+    memset(graph, 0, sizeof(callgraph_t));
+}
+
+/* Releases call graph resources. */
+void callgraph_destroy(callgraph_t *graph) {
+    callgraph_release_edges(graph);
+    free(graph->site);
+    free(graph->node);
+    memset(graph, 0, sizeof(callgraph_t));
+}
+
+/* Records the subroutine calls of a code section. */
+int callgraph_add(callgraph_t *graph, const insn_list_t *list) {
+    uint32_t entry;
+    size_t i;
+    if(list->count == 0) {
+        return 1;
+    }
+    entry = callgraph_address(list->insn[0].logical, list->insn[0].page);
+    if(!mem_reserve((void**)&graph->node, &graph->node_capacity, graph->node_count + 1, sizeof(uint32_t))) {
+        return 0;
+    }
+    graph->node[graph->node_count++] = entry;
+    for(i=0; i<list->count; i++) {
+        const insn_t *insn = &list->insn[i];
+        callgraph_site_t *site;
+        if(insn->data[0] != 0x20) {
+            continue;
+        }
+        if(!mem_reserve((void**)&graph->site, &graph->site_capacity, graph->site_count + 1, sizeof(callgraph_site_t))) {
+            return 0;
+        }
+        site = &graph->site[graph->site_count++];
+        site->entry = entry;
+        site->site = callgraph_address(insn->logical, insn->page);
+        site->callee = callgraph_address(insn->target, insn->target_page);
+    }
+    return 1;
+}
+
+/* Builds call graph nodes and edges. */
+int callgraph_build(callgraph_t *graph) {
+    uint64_t *edge = NULL;
+    size_t i, j, count;
+
+    callgraph_release_edges(graph);
+
+    /* Nodes are section entry points and callees. */
+    if(!mem_reserve((void**)&graph->node, &graph->node_capacity, graph->node_count + graph->site_count, sizeof(uint32_t))) {
+        return 0;
+    }
+    for(i=0; i<graph->site_count; i++) {
+        graph->node[graph->node_count++] = graph->site[i].callee;
+    }
+    if(graph->node_count) {
+        qsort(graph->node, graph->node_count, sizeof(uint32_t), callgraph_address_cmp);
+        for(i=1, j=1; i<graph->node_count; i++) {
+            if(graph->node[i] != graph->node[j-1]) {
+                graph->node[j++] = graph->node[i];
+            }
+        }
+        graph->node_count = j;
+    }
+
+    graph->row = (uint32_t*)calloc(graph->node_count + 1, sizeof(uint32_t));
+    graph->callers = (uint32_t*)calloc(graph->node_count + 1, sizeof(uint32_t));
+    graph->calls = (uint32_t*)calloc(graph->node_count + 1, sizeof(uint32_t));
+    graph->column = (uint32_t*)malloc((graph->site_count + 1) * sizeof(uint32_t));
+    graph->weight = (uint32_t*)malloc((graph->site_count + 1) * sizeof(uint32_t));
+    edge = (uint64_t*)malloc((graph->site_count + 1) * sizeof(uint64_t));
+    if((graph->row == NULL) || (graph->callers == NULL) || (graph->calls == NULL)
+    || (graph->column == NULL) || (graph->weight == NULL) || (edge == NULL)) {
+        ERROR_MSG("Failed to allocate call graph: %s", strerror(errno));
+        goto error;
+    }
+
+    /* Sort (caller, callee) pairs. */
+    for(i=0; i<graph->site_count; i++) {
+        const callgraph_site_t *site = &graph->site[i];
+        ptrdiff_t caller = callgraph_node_find(graph, site->site);
+        ptrdiff_t callee = callgraph_node_find(graph, site->callee);
+        if((caller < 0) || (graph->node[caller] < site->entry)) {
+            caller = callgraph_node_find(graph, site->entry);
+        }
+        edge[i] = ((uint64_t)caller << 32) | (uint64_t)callee;
+        graph->calls[callee]++;
+    }
+    qsort(edge, graph->site_count, sizeof(uint64_t), callgraph_edge_cmp);
+
+    /* Merge duplicate pairs and count the edges of each node. */
+    count = 0;
+    for(i=0; i<graph->site_count; count++) {
+        for(j=i+1; (j<graph->site_count) && (edge[j] == edge[i]); j++) {
+        }
+        graph->column[count] = (uint32_t)edge[i];
+        graph->weight[count] = (uint32_t)(j - i);
+        graph->callers[graph->column[count]]++;
+        graph->row[(edge[i] >> 32) + 1]++;
+        i = j;
+    }
+    graph->edge_count = count;
+
+    /* Row offsets. */
+    for(i=0; i<graph->node_count; i++) {
+        graph->row[i+1] += graph->row[i];
+    }
+    free(edge);
+    return 1;
+
+error:
+    free(edge);
+    callgraph_release_edges(graph);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_CALLGRAPH_H
+#define ETRIPATOR_CALLGRAPH_H
+
+#include "config.h"
+#include "decode.h"
+
+/**
+ * Subroutine call site.
+ * Addresses are stored as (page << 16) | logical.
+ */
+typedef struct {
+    uint32_t entry;   /**< Entry point of the section containing the call. **/
+    uint32_t site;    /**< Address of the jsr instruction. **/
+    uint32_t callee;  /**< Subroutine address. **/
+} callgraph_site_t;
+
+/**
+ * Call graph.
+ * Nodes are routine entry points (section entry points and jsr targets) sorted by address.
+ * The outgoing edges of node i are stored in column[row[i]] to column[row[i+1]-1] (compressed sparse row).
+ */
+typedef struct {
+    callgraph_site_t *site;  /**< Call sites. **/
+    size_t site_count;
+    size_t site_capacity;
+    uint32_t *node;          /**< Node addresses. **/
+    size_t node_count;
+    size_t node_capacity;
+    uint32_t *row;           /**< Index of the first edge of each node (node_count+1 entries). **/
+    uint32_t *column;        /**< Callee node index of each edge. **/
+    uint32_t *weight;        /**< Number of call sites of each edge. **/
+    size_t edge_count;
+    uint32_t *callers;       /**< Number of distinct callers of each node. **/
+    uint32_t *calls;         /**< Number of call sites targeting each node. **/
+} callgraph_t;
+
+/**
+ * Builds a call graph address.
+ * \param [in] logical Logical address.
+ * \param [in] page    Memory page.
+ * \return Call graph address.
+ */
+static inline uint32_t callgraph_address(uint16_t logical, uint8_t page) {
+    return ((uint32_t)page << 16) | logical;
+}
+
+/**
+ * Initializes call graph.
+ * \param [out] graph Call graph.
+ */
+void callgraph_init(callgraph_t *graph);
+
+/**
+ * Releases call graph resources.
+ * \param [in,out] graph Call graph.
+ */
+void callgraph_destroy(callgraph_t *graph);
+
+/**
+ * Records the subroutine calls (jsr) of a code section.
+ * Callee pages are the ones resolved by the decoder from the section memory page registers.
+ * \param [in,out] graph Call graph.
+ * \param [in]     list  Section instructions.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int callgraph_add(callgraph_t *graph, const insn_list_t *list);
+
+/**
+ * Builds call graph nodes and edges from the recorded call sites.
+ * The caller of a call site is the closest node preceding it in the same section.
+ * \param [in,out] graph Call graph.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int callgraph_build(callgraph_t *graph);
+
+#endif // ETRIPATOR_CALLGRAPH_H
@@ -0,0 +1,65 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <errno.h>
+#include <string.h>
+
+#include "save.h"
+#include "../emitter.h"
+#include "../message.h"
+
+/* Call graph output. */
+typedef struct {
+    const callgraph_t *graph;
+    label_repository_t *repository;
+} callgraph_output_t;
+
+static void callgraph_write(emitter_t *out, const void *data) {
+    const callgraph_t *graph = ((const callgraph_output_t*)data)->graph;
+    label_repository_t *repository = ((const callgraph_output_t*)data)->repository;
+    size_t i;
+    emitter_string(out, "[\n");
+    for(i=0; i<graph->node_count; i++) {
+        uint16_t logical = (uint16_t)graph->node[i];
+        uint8_t page = (uint8_t)(graph->node[i] >> 16);
+        char *name = NULL;
+        uint32_t j;
+        emitter_printf(out, "\t{ \"id\":%zu, \"logical\":\"", i);
+        emitter_hex16(out, logical);
+        emitter_string(out, "\", \"page\":\"");
+        emitter_hex8(out, page);
+        emitter_char(out, '"');
+        if(label_repository_find(repository, logical, page, &name)) {
+            emitter_string(out, ", \"label\":\"");
+            emitter_string(out, name);
+            emitter_char(out, '"');
+        }
+        emitter_printf(out, ", \"callers\":%u, \"calls\":%u, \"callees\":[", graph->callers[i], graph->calls[i]);
+        for(j=graph->row[i]; j<graph->row[i+1]; j++) {
+            emitter_printf(out, "%s{ \"id\":%u, \"count\":%u }", (j == graph->row[i]) ? " " : ", ", graph->column[j], graph->weight[j]);
+        }
+        emitter_string(out, (graph->row[i] != graph->row[i+1]) ? " ] }" : "] }");
+        emitter_string(out, ((i+1) < graph->node_count) ? ",\n" : "\n");
+    }
+    emitter_string(out, "]\n");
+}
+
+/* Save call graph as a JSON file. */
+int callgraph_save(const char *filename, const callgraph_t *graph, label_repository_t *repository) {
+    callgraph_output_t output = { graph, repository };
+    return emitter_save(filename, callgraph_write, &output);
+}
@@ -0,0 +1,35 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_CALLGRAPH_SAVE_H
+#define ETRIPATOR_CALLGRAPH_SAVE_H
+
+#include "../callgraph.h"
+#include "../label.h"
+
+/**
+ * Save call graph as a JSON file.
+ * Each routine is written with its number of distinct callers, its number of incoming
+ * call sites and the list of the routines it calls.
+ * \param [in] filename   Output filename.
+ * \param [in] graph      Call graph.
+ * \param [in] repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int callgraph_save(const char *filename, const callgraph_t *graph, label_repository_t *repository);
+
+#endif // ETRIPATOR_CALLGRAPH_SAVE_H
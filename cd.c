@@ -50,43 +50,138 @@ int cd_memmap(memmap_t *map) {
     return ret;
 }
 /**
- * Load CDROM data from file.
- * \param [in]  filename CDROM data filename.
- * \param [in]  start    CDROM data offset.
- * \param [in]  len      CDROM data length (in bytes).
- * \param [in]  page     Memory page.
- * \param [in]  offset   memory page offset.
- * \param [out] memmap   Memory map.
+ * Maps CDROM image into memory.
+ * \param [out] image    CDROM image.
+ * \param [in]  filename CDROM image or cue sheet filename.
  * \return 1 upon success, 0 if an error occured.
  */
-int cd_load(const char* filename, size_t start, size_t len, uint8_t page, size_t offset, memmap_t* map) {
-    FILE *in;
+int cd_open(cd_image_t *image, const char *filename) {
+    char *path;
     int ret;
+    memset(image, 0, sizeof(cd_image_t));
+    filemap_init(&image->file);
+    if(!cd_track_find(filename, &path, &image->track)) {
+        return 0;
+    }
+    ret = filemap_open(&image->file, path);
+    free(path);
+    return ret;
+}
 
-    size_t addr;
-    size_t nRead;
+/**
+ * Unmaps CDROM image.
+ * \param [in,out] image CDROM image.
+ */
+void cd_close(cd_image_t *image) {
+    filemap_close(&image->file);
+}
 
-    in = fopen(filename, "rb");
-    if(in == NULL) {
-        ERROR_MSG("Unable to open %s : %s", filename, strerror(errno));
-        return 0;
+/* Brings back page storage. The current content of the page is preserved. */
+static void cd_page_restore(memmap_t *map, int page) {
+    if(map->store[page] && (map->page[page] != map->store[page])) {
+        memcpy(map->store[page], map->page[page], 8192);
+        map->page[page] = map->store[page];
+        map->rewritten[page] = 1;
     }
+}
+
+/**
+ * Maps CDROM data to memory pages.
+ * Pages are pointed directly to the CDROM image mapped by cd_open whenever
+ * possible. Otherwise data is copied to the page storage.
+ * Raw images are always copied as sector headers must be skipped.
+ * \param [in,out] map    Memory map.
+ * \param [in]     image  CDROM image.
+ * \param [in]     start  CDROM data offset.
+ * \param [in]     len    CDROM data length (in bytes).
+ * \param [in]     page   Memory page.
+ * \param [in]     offset Memory page offset.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_map(memmap_t *map, const cd_image_t *image, size_t start, size_t len, uint8_t page, size_t offset) {
+    const cd_track_t *track = &image->track;
+    size_t addr, count, i;
 
-    ret = fseek(in, (long int)start, SEEK_SET);
-    if(ret) {
-        ERROR_MSG("Offset out of bound : %s", strerror(errno));
-        fclose(in);
+    if(len && (cd_track_offset(track, start + len - 1) >= image->file.len)) {
+        ERROR_MSG("Offset out of bound (%zx, %zx bytes)", start, len);
         return 0;
     }
 
     addr = offset & 0x1fff;
-    nRead = fread(map->page[page] + addr, 1, len, in);    
-    if(nRead != len) {
-        ERROR_MSG("Failed to read %d bytes : %s", len, strerror(errno));
-        fclose(in);
+    count = (addr + len + 0x1fff) / 8192;
+    if((page + count) > 0x100) {
+        ERROR_MSG("Page out of bound (%02x, %zx bytes)", page, len);
         return 0;
     }
-    
-    fclose(in);
+    for(i=0; i<count; i++) {
+        if(map->page[page + i] == NULL) {
+            ERROR_MSG("Page %02x is not mapped", (int)(page + i));
+            return 0;
+        }
+    }
+
+    /* Point pages directly to the image. */
+    if((track->sector_size == 2048) && ((track->offset + start) >= addr) 
+                                    && ((track->offset + start - addr + (count * 8192)) <= image->file.len)) {
+        for(i=0; i<count; i++) {
+            if(map->store[page + i] == NULL) {
+                map->store[page + i] = map->page[page + i];
+            }
+            map->page[page + i] = image->file.data + track->offset + start - addr + (i * 8192);
+        }
+        map->cd = &image->file;
+        return 1;
+    }
+
+    /* Copy data to page storage, one sector at a time. */
+    for(i=0; len; i++, addr=0) {
+        cd_page_restore(map, page + i);
+        map->rewritten[page + i] = 1;
+        while(len && (addr < 8192)) {
+            size_t n = 2048 - (start % 2048);
+            if(n > (8192 - addr)) {
+                n = 8192 - addr;
+            }
+            if(n > len) {
+                n = len;
+            }
+            memcpy(map->page[page + i] + addr, image->file.data + cd_track_offset(track, start), n);
+            start += n;
+            addr += n;
+            len -= n;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Load CDROM data.
+ * \param [in]  reader   CDROM image reader.
+ * \param [in]  start    CDROM data offset.
+ * \param [in]  len      CDROM data length (in bytes).
+ * \param [in]  page     Memory page.
+ * \param [in]  offset   memory page offset.
+ * \param [out] memmap   Memory map.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_load(cd_reader_t *reader, size_t start, size_t len, uint8_t page, size_t offset, memmap_t* map) {
+    size_t addr, i;
+    for(i=page, addr=offset & 0x1fff; len; i++, addr=0) {
+        size_t n = 8192 - addr;
+        if(n > len) {
+            n = len;
+        }
+        if((i > 0xff) || (map->page[i] == NULL)) {
+            ERROR_MSG("Page %02x is not mapped", (int)i);
+            return 0;
+        }
+        cd_page_restore(map, (int)i);
+        map->rewritten[i] = 1;
+        if(!cd_reader_read(reader, start, map->page[i] + addr, n)) {
+            return 0;
+        }
+        start += n;
+        len -= n;
+    }
     return 1;
 }
@@ -20,6 +20,7 @@
 
 #include "config.h"
 #include "memorymap.h"
+#include "cd/reader.h"
 
 /**
  * Adds CD RAM to memory map.
@@ -29,8 +30,45 @@
 int cd_memmap(memmap_t *map);
 
 /**
- * Load CDROM data from file.
- * \param [in]  filename CDROM data filename.
+ * Memory mapped CDROM image.
+ */
+typedef struct {
+    filemap_t file;   /**< Image file mapping. **/
+    cd_track_t track; /**< Data track layout. **/
+} cd_image_t;
+
+/**
+ * Maps CDROM image into memory.
+ * \param [out] image    CDROM image.
+ * \param [in]  filename CDROM image or cue sheet filename.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_open(cd_image_t *image, const char *filename);
+
+/**
+ * Unmaps CDROM image.
+ * \param [in,out] image CDROM image.
+ */
+void cd_close(cd_image_t *image);
+
+/**
+ * Maps CDROM data to memory pages.
+ * Pages are pointed directly to the CDROM image mapped by cd_open whenever
+ * possible. Otherwise data is copied to the page storage.
+ * Raw images are always copied as sector headers must be skipped.
+ * \param [in,out] map    Memory map.
+ * \param [in]     image  CDROM image.
+ * \param [in]     start  CDROM data offset.
+ * \param [in]     len    CDROM data length (in bytes).
+ * \param [in]     page   Memory page.
+ * \param [in]     offset Memory page offset.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_map(memmap_t *map, const cd_image_t *image, size_t start, size_t len, uint8_t page, size_t offset);
+
+/**
+ * Load CDROM data.
+ * \param [in]  reader   CDROM image reader.
  * \param [in]  start    CDROM data offset.
  * \param [in]  len      CDROM data length (in bytes).
  * \param [in]  page     Memory page.
@@ -38,6 +76,6 @@ int cd_memmap(memmap_t *map);
  * \param [out] memmap   Memory map.
  * \return 1 upon success, 0 if an error occured.
  */
-int cd_load(const char* filename, size_t start, size_t len, uint8_t page, size_t offset, memmap_t* map);
+int cd_load(cd_reader_t *reader, size_t start, size_t len, uint8_t page, size_t offset, memmap_t* map);
 
 #endif // ETRIPATOR_CD_H
@@ -0,0 +1,222 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cue.h"
+#include "../message.h"
+
+#define CD_RAW_SECTOR_SIZE 2352
+
+static const uint8_t cd_sync[12] = {
+    0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+};
+
+/* Set track layout from a cue sheet track type.
+ * Returns 1 for data tracks, 0 for audio tracks and -1 for unsupported tracks. */
+static int cd_track_type(const char *type, cd_track_t *track) {
+    if(!strcasecmp(type, "AUDIO")) {
+        track->sector_size = CD_RAW_SECTOR_SIZE;
+        track->header_size = 0;
+        return 0;
+    }
+    if(!strcasecmp(type, "MODE1/2048")) {
+        track->sector_size = 2048;
+        track->header_size = 0;
+    }
+    else if(!strcasecmp(type, "MODE1/2352")) {
+        track->sector_size = CD_RAW_SECTOR_SIZE;
+        track->header_size = 16;
+    }
+    else {
+        return -1;
+    }
+    return 1;
+}
+
+/* Build image path. Relative paths are relative to the cue sheet directory. */
+static char* cd_image_path(const char *cue, const char *name) {
+    const char *end;
+    char *path;
+    size_t len;
+
+    if((name[0] == '/') || (name[0] == '\\') || (name[0] && (name[1] == ':'))) {
+        return strdup(name);
+    }
+    for(end=cue+strlen(cue); (end > cue) && (end[-1] != '/') && (end[-1] != '\\'); end--) {
+    }
+    len = (size_t)(end - cue);
+    path = (char*)malloc(len + strlen(name) + 1);
+    if(path != NULL) {
+        memcpy(path, cue, len);
+        strcpy(path + len, name);
+    }
+    return path;
+}
+
+/* Parse cue sheet and find the first data track. */
+static int cd_cue_parse(const char *filename, char **image, cd_track_t *track) {
+    char line[512];
+    char file[512];
+    FILE *in;
+    int found, data, line_count;
+    size_t position, frame, sector_size;
+
+    in = fopen(filename, "rb");
+    if(in == NULL) {
+        ERROR_MSG("Unable to open %s : %s", filename, strerror(errno));
+        return 0;
+    }
+
+    file[0] = '\0';
+    found = data = 0;
+    /* File offset and frame of the last index. Sectors up to the next index have the size of its track. */
+    position = frame = 0;
+    sector_size = 0;
+    for(line_count=1; !found && fgets(line, sizeof(line), in); line_count++) {
+        char keyword[16], arg[512];
+        unsigned int m, s, f, index, number;
+        char *ptr;
+        for(ptr=line; isspace((unsigned char)*ptr); ptr++) {
+        }
+        if(sscanf(ptr, "%15s", keyword) != 1) {
+            continue;
+        }
+        ptr += strlen(keyword);
+        if(!strcasecmp(keyword, "FILE")) {
+            char *begin, *end;
+            begin = strchr(ptr, '"');
+            end = begin ? strchr(begin+1, '"') : NULL;
+            if(end) {
+                begin++;
+            }
+            else if(sscanf(ptr, "%511s", arg) == 1) {
+                begin = ptr + strspn(ptr, " \t");
+                end = begin + strlen(arg);
+            }
+            else {
+                ERROR_MSG("%s:%d: missing filename", filename, line_count);
+                break;
+            }
+            snprintf(file, sizeof(file), "%.*s", (int)(end - begin), begin);
+            position = frame = 0;
+            sector_size = 0;
+        }
+        else if(!strcasecmp(keyword, "TRACK")) {
+            if(sscanf(ptr, "%u %511s", &number, arg) != 2) {
+                ERROR_MSG("%s:%d: invalid track", filename, line_count);
+                break;
+            }
+            data = cd_track_type(arg, track);
+            if(data < 0) {
+                ERROR_MSG("%s:%d: unsupported data track type %s for track %u (only MODE1/2048 and MODE1/2352 are supported)", filename, line_count, arg, number);
+                break;
+            }
+        }
+        else if(!strcasecmp(keyword, "INDEX")) {
+            size_t current;
+            if(sscanf(ptr, "%u %u:%u:%u", &index, &m, &s, &f) != 4) {
+                ERROR_MSG("%s:%d: invalid index", filename, line_count);
+                break;
+            }
+            current = ((m * 60) + s) * 75 + f;
+            if(current < frame) {
+                ERROR_MSG("%s:%d: index is not in ascending order", filename, line_count);
+                break;
+            }
+            position += (current - frame) * (sector_size ? sector_size : track->sector_size);
+            frame = current;
+            sector_size = track->sector_size;
+            if(data && (index == 1)) {
+                track->offset = position;
+                found = 1;
+            }
+        }
+    }
+    fclose(in);
+
+    if(!found) {
+        if(data >= 0) {
+            ERROR_MSG("No data track found in %s", filename);
+        }
+        return 0;
+    }
+    if(file[0] == '\0') {
+        ERROR_MSG("Missing image filename in %s", filename);
+        return 0;
+    }
+    *image = cd_image_path(filename, file);
+    if(*image == NULL) {
+        ERROR_MSG("Failed to allocate image filename : %s", strerror(errno));
+        return 0;
+    }
+    INFO_MSG("Data track: %s, offset %zx, sector size %zu", *image, track->offset, track->sector_size);
+    return 1;
+}
+
+/**
+ * Find CDROM data track.
+ * If the filename is a cue sheet, the first data track is used and the image
+ * filename is read from the cue sheet. Otherwise the file is checked for raw
+ * sectors. Files without sync patterns are considered as cooked images.
+ * Only mode 1 data tracks are supported.
+ * \param [in]  filename CDROM image or cue sheet filename.
+ * \param [out] image    CDROM image filename. It must be freed by the caller.
+ * \param [out] track    Data track layout.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_track_find(const char *filename, char **image, cd_track_t *track) {
+    uint8_t header[16];
+    const char *ext;
+    FILE *in;
+    long size;
+
+    *image = NULL;
+    track->offset = 0;
+    track->sector_size = 2048;
+    track->header_size = 0;
+
+    ext = strrchr(filename, '.');
+    if(ext && !strcasecmp(ext, ".cue")) {
+        return cd_cue_parse(filename, image, track);
+    }
+
+    in = fopen(filename, "rb");
+    if(in == NULL) {
+        ERROR_MSG("Unable to open %s : %s", filename, strerror(errno));
+        return 0;
+    }
+    fseek(in, 0, SEEK_END);
+    size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if((size > 0) && ((size % CD_RAW_SECTOR_SIZE) == 0) && (fread(header, 1, 16, in) == 16)
+       && !memcmp(header, cd_sync, sizeof(cd_sync))) {
+        if(header[15] != 1) {
+            ERROR_MSG("%s: unsupported sector mode %d (only mode 1 is supported)", filename, header[15]);
+            fclose(in);
+            return 0;
+        }
+        track->sector_size = CD_RAW_SECTOR_SIZE;
+        track->header_size = 16;
+    }
+    fclose(in);
+
+    *image = strdup(filename);
+    if(*image == NULL) {
+        ERROR_MSG("Failed to allocate image filename : %s", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
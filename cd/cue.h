@@ -0,0 +1,57 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_CD_CUE_H
+#define ETRIPATOR_CD_CUE_H
+
+#include "../config.h"
+
+/**
+ * CDROM data track layout.
+ * Records are 2048 bytes of user data. Raw images store them in 2352 bytes
+ * sectors preceded by sync and header bytes.
+ */
+typedef struct {
+    size_t offset;      /**< Offset of the first data track sector in the image file. **/
+    size_t sector_size; /**< Sector size in bytes (2048 for cooked images). **/
+    size_t header_size; /**< Number of bytes preceding user data in each sector. **/
+} cd_track_t;
+
+/**
+ * Find CDROM data track.
+ * If the filename is a cue sheet, the first data track is used and the image
+ * filename is read from the cue sheet. Otherwise the file is checked for raw
+ * sectors. Files without sync patterns are considered as cooked images.
+ * Only mode 1 data tracks are supported.
+ * \param [in]  filename CDROM image or cue sheet filename.
+ * \param [out] image    CDROM image filename. It must be freed by the caller.
+ * \param [out] track    Data track layout.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_track_find(const char *filename, char **image, cd_track_t *track);
+
+/**
+ * Get the offset in the image file of a byte in the data track.
+ * \param [in] track  Data track layout.
+ * \param [in] offset Data offset (record * 2048 + byte index).
+ * \return Image file offset.
+ */
+static inline size_t cd_track_offset(const cd_track_t *track, size_t offset) {
+    return track->offset + ((offset / 2048) * track->sector_size) + track->header_size + (offset % 2048);
+}
+
+#endif // ETRIPATOR_CD_CUE_H
@@ -0,0 +1,128 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "reader.h"
+#include "../message.h"
+
+/* Positioned read. Returns the number of bytes read or -1 if an error occured. */
+static long cd_reader_pread(cd_reader_t *reader, uint8_t *buffer, size_t len, size_t offset) {
+#if defined(_MSC_VER)
+    OVERLAPPED overlapped;
+    DWORD nread = 0;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = (DWORD)((uint64_t)offset & 0xffffffff);
+    overlapped.OffsetHigh = (DWORD)((uint64_t)offset >> 32);
+    if(!ReadFile(reader->file, buffer, (DWORD)len, &nread, &overlapped)) {
+        return (GetLastError() == ERROR_HANDLE_EOF) ? 0 : -1;
+    }
+    return (long)nread;
+#else
+    size_t total = 0;
+    while(total < len) {
+        ssize_t n = pread(reader->fd, buffer + total, len - total, (off_t)(offset + total));
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if(n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    return (long)total;
+#endif
+}
+
+/**
+ * Open CDROM image.
+ * \param [out] reader   CDROM image reader.
+ * \param [in]  filename CDROM image or cue sheet filename.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_reader_open(cd_reader_t *reader, const char *filename) {
+    char *image;
+    int ret = 1;
+    if(!cd_track_find(filename, &image, &reader->track)) {
+        return 0;
+    }
+#if defined(_MSC_VER)
+    reader->file = CreateFileA(image, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(reader->file == INVALID_HANDLE_VALUE) {
+        ERROR_MSG("Unable to open %s : error %lu", image, GetLastError());
+        ret = 0;
+    }
+#else
+    reader->fd = open(image, O_RDONLY);
+    if(reader->fd < 0) {
+        ERROR_MSG("Unable to open %s : %s", image, strerror(errno));
+        ret = 0;
+    }
+#endif
+    free(image);
+    return ret;
+}
+
+/**
+ * Close CDROM image.
+ * \param [in,out] reader CDROM image reader.
+ */
+void cd_reader_close(cd_reader_t *reader) {
+#if defined(_MSC_VER)
+    if(reader->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(reader->file);
+    }
+    reader->file = INVALID_HANDLE_VALUE;
+#else
+    if(reader->fd >= 0) {
+        close(reader->fd);
+    }
+    reader->fd = -1;
+#endif
+}
+
+/**
+ * Read data from CDROM image.
+ * \param [in,out] reader CDROM image reader.
+ * \param [in]     offset Data offset (record * 2048 + byte index).
+ * \param [out]    buffer Output buffer.
+ * \param [in]     len    Number of bytes to read.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_reader_read(cd_reader_t *reader, size_t offset, uint8_t *buffer, size_t len) {
+    while(len) {
+        size_t n = len;
+        long nread;
+        if(reader->track.sector_size != CD_SECTOR_SIZE) {
+            /* Raw sectors. Only the user data of the current sector is read. */
+            n = CD_SECTOR_SIZE - (offset % CD_SECTOR_SIZE);
+            if(n > len) {
+                n = len;
+            }
+        }
+        nread = cd_reader_pread(reader, buffer, n, cd_track_offset(&reader->track, offset));
+        if(nread != (long)n) {
+            ERROR_MSG("Failed to read %zu bytes at %zx : %s", n, offset, (nread < 0) ? strerror(errno) : "end of file");
+            return 0;
+        }
+        buffer += n;
+        offset += n;
+        len -= n;
+    }
+    return 1;
+}
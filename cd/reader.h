@@ -0,0 +1,63 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_CD_READER_H
+#define ETRIPATOR_CD_READER_H
+
+#include "../config.h"
+#include "cue.h"
+
+#define CD_SECTOR_SIZE 2048
+/**
+ * CDROM image reader.
+ * The image file is kept open and data is read with positioned reads.
+ * Only the user data of raw sectors is read.
+ */
+typedef struct {
+    cd_track_t track; /**< Data track layout. **/
+#if defined(_MSC_VER)
+    HANDLE file;     /**< File handle. **/
+#else
+    int fd;          /**< File descriptor. **/
+#endif
+} cd_reader_t;
+
+/**
+ * Open CDROM image.
+ * \param [out] reader   CDROM image reader.
+ * \param [in]  filename CDROM image or cue sheet filename.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_reader_open(cd_reader_t *reader, const char *filename);
+
+/**
+ * Close CDROM image.
+ * \param [in,out] reader CDROM image reader.
+ */
+void cd_reader_close(cd_reader_t *reader);
+
+/**
+ * Read data from CDROM image.
+ * \param [in,out] reader CDROM image reader.
+ * \param [in]     offset Data offset (record * 2048 + byte index).
+ * \param [out]    buffer Output buffer.
+ * \param [in]     len    Number of bytes to read.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_reader_read(cd_reader_t *reader, size_t offset, uint8_t *buffer, size_t len);
+
+#endif // ETRIPATOR_CD_READER_H
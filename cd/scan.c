@@ -0,0 +1,552 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "scan.h"
+#include "../opcodes.h"
+#include "../message.h"
+
+#if !defined(_MSC_VER)
+#include <pthread.h>
+#endif
+
+#define CD_SCAN_LOOKBEHIND 64
+#define CD_SCAN_MAX_JOBS 64
+
+/* System card registers ($20f8-$20ff) followed by A, X and Y. */
+enum {
+    CD_SCAN_AL = 0,
+    CD_SCAN_AH,
+    CD_SCAN_BL,
+    CD_SCAN_BH,
+    CD_SCAN_CL,
+    CD_SCAN_CH,
+    CD_SCAN_DL,
+    CD_SCAN_DH,
+    CD_SCAN_A,
+    CD_SCAN_X,
+    CD_SCAN_Y,
+    CD_SCAN_REG_COUNT
+};
+
+/* Values known at a given point of the code. */
+typedef struct {
+    uint8_t value[CD_SCAN_REG_COUNT];
+    uint8_t known[CD_SCAN_REG_COUNT];
+} cd_scan_state_t;
+
+/* Worker data. */
+typedef struct {
+    const cd_image_t *image;
+    uint32_t first;         /**< First record to scan. **/
+    uint32_t last;          /**< Last record to scan (excluded). **/
+    uint32_t records;       /**< Number of records in the data track. **/
+    cd_overlay_t *overlay;
+    size_t count;
+    size_t capacity;
+    int failed;
+} cd_scan_job_t;
+
+/* Mnemonics of instructions writing to memory. */
+static const char *cd_scan_writers[] = {
+    "sta", "stx", "sty", "stz", "inc", "dec", "asl", "lsr", "rol", "ror",
+    "tsb", "trb", "rmb", "smb", "tii", "tdd", "tin", "tia", "tai", NULL
+};
+
+/* Mnemonics of instructions leaving A, X and Y untouched. */
+static const char *cd_scan_preservers[] = {
+    "nop", "clc", "sec", "cli", "sei", "cld", "sed", "clv", "php", "pha",
+    "phx", "phy", "tam", "csh", "csl", "st0", "st1", "st2", "cmp", "cpx",
+    "cpy", "bit", "tst", NULL
+};
+
+static int cd_scan_match(const opcode_t *opcode, const char **names) {
+    int i;
+    for(i=0; names[i]; i++) {
+        if(!strncmp(opcode->name, names[i], 3)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Copy user data from the data track. */
+static void cd_scan_copy(const cd_image_t *image, size_t offset, uint8_t *out, size_t len) {
+    while(len) {
+        size_t n = 2048 - (offset % 2048);
+        if(n > len) {
+            n = len;
+        }
+        memcpy(out, image->file.data + cd_track_offset(&image->track, offset), n);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+static void cd_scan_set(cd_scan_state_t *state, int reg, uint8_t value) {
+    state->value[reg] = value;
+    state->known[reg] = 1;
+}
+
+static void cd_scan_copy_reg(cd_scan_state_t *state, int dst, int src) {
+    state->value[dst] = state->value[src];
+    state->known[dst] = state->known[src];
+}
+
+static void cd_scan_swap(cd_scan_state_t *state, int a, int b) {
+    uint8_t value = state->value[a];
+    uint8_t known = state->known[a];
+    cd_scan_copy_reg(state, a, b);
+    state->value[b] = value;
+    state->known[b] = known;
+}
+
+/* Store register (or zero if src is negative) to memory. */
+static void cd_scan_store(cd_scan_state_t *state, uint16_t addr, int src) {
+    if((addr >= 0x20f8) && (addr <= 0x20ff)) {
+        int reg = addr - 0x20f8;
+        if(src < 0) {
+            cd_scan_set(state, reg, 0);
+        }
+        else {
+            cd_scan_copy_reg(state, reg, src);
+        }
+    }
+}
+
+/* Update known values with a single instruction. Returns 0 for invalid opcodes. */
+static int cd_scan_step(cd_scan_state_t *state, const uint8_t *insn, const opcode_t *opcode) {
+    uint8_t op = insn[0];
+    uint16_t addr = insn[1] | (insn[2] << 8);
+    int i;
+
+    if(opcode->type == PCE_unknown) {
+        return 0;
+    }
+    /* Nothing is known after a jump or a return. */
+    if(opcode_is_local_jump(op) || opcode_is_far_jump(op) || (op == 0x6c) || (op == 0x7c) 
+                                || (op == 0x00) || (op == 0x40) || (op == 0x60) || (op == 0xf4)) {
+        memset(state->known, 0, sizeof(state->known));
+        return 1;
+    }
+    switch(op) {
+        case 0xa9: cd_scan_set(state, CD_SCAN_A, insn[1]); return 1; /* lda #nn */
+        case 0xa2: cd_scan_set(state, CD_SCAN_X, insn[1]); return 1; /* ldx #nn */
+        case 0xa0: cd_scan_set(state, CD_SCAN_Y, insn[1]); return 1; /* ldy #nn */
+        case 0x62: cd_scan_set(state, CD_SCAN_A, 0); return 1;       /* cla */
+        case 0x82: cd_scan_set(state, CD_SCAN_X, 0); return 1;       /* clx */
+        case 0xc2: cd_scan_set(state, CD_SCAN_Y, 0); return 1;       /* cly */
+        case 0xaa: cd_scan_copy_reg(state, CD_SCAN_X, CD_SCAN_A); return 1; /* tax */
+        case 0x8a: cd_scan_copy_reg(state, CD_SCAN_A, CD_SCAN_X); return 1; /* txa */
+        case 0xa8: cd_scan_copy_reg(state, CD_SCAN_Y, CD_SCAN_A); return 1; /* tay */
+        case 0x98: cd_scan_copy_reg(state, CD_SCAN_A, CD_SCAN_Y); return 1; /* tya */
+        case 0x02: cd_scan_swap(state, CD_SCAN_X, CD_SCAN_Y); return 1; /* sxy */
+        case 0x22: cd_scan_swap(state, CD_SCAN_A, CD_SCAN_X); return 1; /* sax */
+        case 0x42: cd_scan_swap(state, CD_SCAN_A, CD_SCAN_Y); return 1; /* say */
+        case 0x85: cd_scan_store(state, 0x2000 | insn[1], CD_SCAN_A); return 1; /* sta ZZ */
+        case 0x86: cd_scan_store(state, 0x2000 | insn[1], CD_SCAN_X); return 1; /* stx ZZ */
+        case 0x84: cd_scan_store(state, 0x2000 | insn[1], CD_SCAN_Y); return 1; /* sty ZZ */
+        case 0x64: cd_scan_store(state, 0x2000 | insn[1], -1); return 1;        /* stz ZZ */
+        case 0x8d: cd_scan_store(state, addr, CD_SCAN_A); return 1; /* sta hhll */
+        case 0x8e: cd_scan_store(state, addr, CD_SCAN_X); return 1; /* stx hhll */
+        case 0x8c: cd_scan_store(state, addr, CD_SCAN_Y); return 1; /* sty hhll */
+        case 0x9c: cd_scan_store(state, addr, -1); return 1;        /* stz hhll */
+    }
+    if((opcode->type != PCE_OP) && (opcode->type != PCE_OP_A) && cd_scan_match(opcode, cd_scan_writers)) {
+        if(opcode->type == PCE_OP_ZZ) {
+            addr = 0x2000 | insn[1];
+        }
+        if((opcode->type == PCE_OP_ZZ) || (opcode->type == PCE_OP_hhll)) {
+            if((addr >= 0x20f8) && (addr <= 0x20ff)) {
+                state->known[addr - 0x20f8] = 0;
+            }
+        }
+        else {
+            /* Indexed, indirect or block transfer. */
+            for(i=CD_SCAN_AL; i<=CD_SCAN_DH; i++) {
+                state->known[i] = 0;
+            }
+        }
+    }
+    else if(!cd_scan_match(opcode, cd_scan_preservers)) {
+        state->known[CD_SCAN_A] = state->known[CD_SCAN_X] = state->known[CD_SCAN_Y] = 0;
+    }
+    return 1;
+}
+
+/* Retrieve CD_READ parameters from known values. */
+static int cd_scan_params(const cd_scan_state_t *state, cd_overlay_t *overlay) {
+    const uint8_t *v = state->value;
+    int i;
+    for(i=CD_SCAN_CL; i<=CD_SCAN_DH; i++) {
+        if(!state->known[i]) {
+            return 0;
+        }
+    }
+    overlay->record = (v[CD_SCAN_CL] << 16) | (v[CD_SCAN_CH] << 8) | v[CD_SCAN_DL];
+    overlay->mode = v[CD_SCAN_DH];
+    overlay->bank = 0;
+    if(overlay->mode == 0) {
+        /* Local memory, _bx address, _ax bytes. */
+        if(!(state->known[CD_SCAN_AL] && state->known[CD_SCAN_AH] && state->known[CD_SCAN_BL] && state->known[CD_SCAN_BH])) {
+            return 0;
+        }
+        overlay->logical = v[CD_SCAN_BL] | (v[CD_SCAN_BH] << 8);
+        overlay->size = v[CD_SCAN_AL] | (v[CD_SCAN_AH] << 8);
+    }
+    else if(overlay->mode == 1) {
+        /* Local memory, _bx address, _al records. */
+        if(!(state->known[CD_SCAN_AL] && state->known[CD_SCAN_BL] && state->known[CD_SCAN_BH])) {
+            return 0;
+        }
+        overlay->logical = v[CD_SCAN_BL] | (v[CD_SCAN_BH] << 8);
+        overlay->size = v[CD_SCAN_AL] * 2048;
+    }
+    else if(overlay->mode <= 6) {
+        /* Bank _bl mapped to MPR _dh, _al records. */
+        if(!(state->known[CD_SCAN_AL] && state->known[CD_SCAN_BL])) {
+            return 0;
+        }
+        overlay->logical = overlay->mode << 13;
+        overlay->bank = v[CD_SCAN_BL];
+        overlay->size = v[CD_SCAN_AL] * 2048;
+    }
+    else {
+        /* VRAM */
+        return 0;
+    }
+    /* Code is expected to be loaded in banks mapped by MPR 2 to 6. */
+    if((overlay->size <= 0) || ((overlay->logical >> 13) < 2) || ((overlay->logical >> 13) > 6)) {
+        return 0;
+    }
+    /* Local loads stop at the end of the logical address space. */
+    if((overlay->mode <= 1) && ((overlay->logical + overlay->size) > 0x10000)) {
+        overlay->size = 0x10000 - overlay->logical;
+    }
+    return 1;
+}
+
+/* Retrieve CD_READ parameters from the code preceding the call at buffer[call]. */
+int cd_scan_call(const uint8_t *buffer, size_t call, cd_overlay_t *overlay) {
+    cd_scan_state_t state;
+    size_t start, i;
+
+    /* The bytes preceding the call may be decoded from several starting points.
+     * The first instruction stream reaching the call with all parameters set is used. */
+    start = (call > CD_SCAN_LOOKBEHIND) ? (call - CD_SCAN_LOOKBEHIND) : 0;
+    for(; start<call; start++) {
+        int valid = 1;
+        memset(&state, 0, sizeof(state));
+        for(i=start; valid && (i<call); ) {
+            const opcode_t *opcode = opcode_get(buffer[i]);
+            valid = cd_scan_step(&state, buffer+i, opcode);
+            i += opcode->size;
+        }
+        if(valid && (i == call) && cd_scan_params(&state, overlay)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int cd_scan_add(cd_scan_job_t *job, const cd_overlay_t *overlay) {
+    if(job->count >= job->capacity) {
+        size_t capacity = job->capacity ? (job->capacity * 2) : 64;
+        cd_overlay_t *tmp = (cd_overlay_t*)realloc(job->overlay, capacity * sizeof(cd_overlay_t));
+        if(tmp == NULL) {
+            return 0;
+        }
+        job->overlay = tmp;
+        job->capacity = capacity;
+    }
+    job->overlay[job->count++] = *overlay;
+    return 1;
+}
+
+/* Scan records for CD_READ calls. */
+static void cd_scan_job_run(cd_scan_job_t *job) {
+    uint8_t buffer[CD_SCAN_LOOKBEHIND + 2048 + 2];
+    size_t total = (size_t)job->records * 2048;
+    uint32_t record;
+
+    for(record=job->first; record<job->last; record++) {
+        size_t offset = (size_t)record * 2048;
+        size_t before = (offset < CD_SCAN_LOOKBEHIND) ? offset : CD_SCAN_LOOKBEHIND;
+        size_t after = ((total - offset - 2048) < 2) ? (total - offset - 2048) : 2;
+        size_t len = before + 2048 + after;
+        size_t end = before + 2048;
+        const uint8_t *ptr;
+
+        cd_scan_copy(job->image, offset - before, buffer, len);
+        /* Look for jsr $e009 */
+        for(ptr=buffer+before; (ptr=(const uint8_t*)memchr(ptr, 0x20, (buffer + end) - ptr)) != NULL; ptr++) {
+            size_t call = ptr - buffer;
+            cd_overlay_t overlay;
+            if(((call + 2) >= len) || (ptr[1] != 0x09) || (ptr[2] != 0xe0)) {
+                continue;
+            }
+            if(!cd_scan_call(buffer, call, &overlay)) {
+                continue;
+            }
+            if(((size_t)overlay.record * 2048 + overlay.size) > total) {
+                continue;
+            }
+            if(!cd_scan_add(job, &overlay)) {
+                job->failed = 1;
+                return;
+            }
+        }
+    }
+}
+
+#if defined(_MSC_VER)
+static DWORD WINAPI cd_scan_thread(LPVOID arg) {
+    cd_scan_job_run((cd_scan_job_t*)arg);
+    return 0;
+}
+#else
+static void* cd_scan_thread(void *arg) {
+    cd_scan_job_run((cd_scan_job_t*)arg);
+    return NULL;
+}
+#endif
+
+static int cd_scan_cpu_count(void) {
+#if defined(_MSC_VER)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#endif
+}
+
+/* Run jobs on worker threads. Jobs that could not be started are run on the calling thread. */
+static void cd_scan_run(cd_scan_job_t *job, int count) {
+    int i;
+#if defined(_MSC_VER)
+    HANDLE thread[CD_SCAN_MAX_JOBS];
+    for(i=1; i<count; i++) {
+        thread[i] = CreateThread(NULL, 0, cd_scan_thread, &job[i], 0, NULL);
+    }
+    cd_scan_job_run(&job[0]);
+    for(i=1; i<count; i++) {
+        if(thread[i] != NULL) {
+            WaitForSingleObject(thread[i], INFINITE);
+            CloseHandle(thread[i]);
+        }
+        else {
+            cd_scan_job_run(&job[i]);
+        }
+    }
+#else
+    pthread_t thread[CD_SCAN_MAX_JOBS];
+    int started[CD_SCAN_MAX_JOBS];
+    for(i=1; i<count; i++) {
+        started[i] = (pthread_create(&thread[i], NULL, cd_scan_thread, &job[i]) == 0);
+    }
+    cd_scan_job_run(&job[0]);
+    for(i=1; i<count; i++) {
+        if(started[i]) {
+            pthread_join(thread[i], NULL);
+        }
+        else {
+            cd_scan_job_run(&job[i]);
+        }
+    }
+#endif
+}
+
+static int cd_overlay_compare(const void *a, const void *b) {
+    const cd_overlay_t *x = (const cd_overlay_t*)a;
+    const cd_overlay_t *y = (const cd_overlay_t*)b;
+    if(x->record != y->record) {
+        return (x->record < y->record) ? -1 : 1;
+    }
+    if(x->logical != y->logical) {
+        return (x->logical < y->logical) ? -1 : 1;
+    }
+    if(x->mode != y->mode) {
+        return (x->mode < y->mode) ? -1 : 1;
+    }
+    if(x->bank != y->bank) {
+        return (x->bank < y->bank) ? -1 : 1;
+    }
+    return (x->size < y->size) ? -1 : ((x->size > y->size) ? 1 : 0);
+}
+
+/* Add overlay sections. Loads to banks are split into one section per bank. */
+int cd_scan_sections(const ipl_t *ipl, const cd_overlay_t *overlay, size_t n, section_t **out, int *count) {
+    section_t *section;
+    char name[64];
+    size_t i, total;
+    int j;
+
+    for(i=0, total=0; i<n; i++) {
+        total += ((overlay[i].mode >= 2) && (overlay[i].mode <= 6)) ? ((overlay[i].size + 0x1fff) / 0x2000) : 1;
+    }
+    section = (section_t*)realloc(*out, (*count + total) * sizeof(section_t));
+    if(section == NULL) {
+        ERROR_MSG("Failed to add overlay sections.");
+        return 0;
+    }
+    *out = section;
+
+    for(i=0; i<n; i++) {
+        int banked = (overlay[i].mode >= 2) && (overlay[i].mode <= 6);
+        int32_t offset;
+        for(offset=0; offset<overlay[i].size; offset+=0x2000) {
+            section_t *current = &section[*count];
+            uint32_t record = overlay[i].record + (offset / 2048);
+            section_reset(current);
+            current->mpr[0] = 0xff;
+            current->mpr[1] = 0xf8;
+            for(j=0; j<5; j++) {
+                current->mpr[2+j] = 0x80 + ipl->mpr[j];
+            }
+            current->mpr[7] = 0x00;
+            current->type    = Code;
+            current->logical = overlay[i].logical;
+            current->offset  = record * 2048;
+            if(banked) {
+                /* Bank _bl+k is mapped by MPR _dh while the k-th 8KB block is loaded. */
+                current->mpr[overlay[i].mode] = (uint8_t)(overlay[i].bank + (offset / 0x2000));
+                current->size = ((overlay[i].size - offset) < 0x2000) ? (overlay[i].size - offset) : 0x2000;
+            }
+            else {
+                current->size = overlay[i].size;
+            }
+            current->page = current->mpr[overlay[i].logical >> 13];
+
+            snprintf(name, sizeof(name), "overlay_%06x_%02x_%04x", record, current->page, current->logical);
+            current->name = strdup(name);
+            strcat(name, ".asm");
+            current->output = strdup(name);
+            if((current->name == NULL) || (current->output == NULL)) {
+                ERROR_MSG("Failed to allocate section name.");
+                free(current->name);
+                free(current->output);
+                return 0;
+            }
+            INFO_MSG("Overlay: record %06x, %04x bytes, page %02x, logical %04x", record, current->size, current->page, current->logical);
+            (*count)++;
+            if(!banked) {
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * Scan CDROM data track for overlays.
+ * The data track is split between worker threads and scanned sector by sector
+ * for system card CD_READ calls (jsr $e009) whose parameters are set with
+ * immediate values. A Code section is added for each load found and for the
+ * IPL boot program. The sections use the memory page registers set by the IPL.
+ * \param [in]     image CDROM image.
+ * \param [in,out] out   Sections.
+ * \param [in,out] count Section count.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_scan(const cd_image_t *image, section_t **out, int *count) {
+    cd_scan_job_t job[CD_SCAN_MAX_JOBS];
+    cd_overlay_t *overlay;
+    uint8_t buffer[IPL_DATA_SIZE];
+    ipl_t ipl;
+    uint32_t records;
+    size_t n, m, i;
+    int jobs, k, ret;
+
+    if(image->file.len <= image->track.offset) {
+        ERROR_MSG("Empty data track.");
+        return 0;
+    }
+    records = (uint32_t)((image->file.len - image->track.offset) / image->track.sector_size);
+    if(((size_t)records * 2048) < (IPL_OFFSET + IPL_DATA_SIZE)) {
+        ERROR_MSG("Data track is too small.");
+        return 0;
+    }
+    cd_scan_copy(image, IPL_OFFSET, buffer, IPL_DATA_SIZE);
+    ipl_parse_buffer(&ipl, buffer, IPL_DATA_SIZE);
+
+    jobs = cd_scan_cpu_count();
+    if(jobs > CD_SCAN_MAX_JOBS) {
+        jobs = CD_SCAN_MAX_JOBS;
+    }
+    if((uint32_t)jobs > records) {
+        jobs = (int)records;
+    }
+    INFO_MSG("Scanning %u records with %d threads.", records, jobs);
+
+    memset(job, 0, sizeof(job));
+    for(k=0; k<jobs; k++) {
+        job[k].image = image;
+        job[k].records = records;
+        job[k].first = (uint32_t)(((uint64_t)records * k) / jobs);
+        job[k].last = (uint32_t)(((uint64_t)records * (k+1)) / jobs);
+    }
+    cd_scan_run(job, jobs);
+
+    /* Gather overlays. The IPL boot program is added first. */
+    n = 1;
+    for(k=0; k<jobs; k++) {
+        n += job[k].count;
+    }
+    overlay = (cd_overlay_t*)malloc(n * sizeof(cd_overlay_t));
+    ret = (overlay != NULL);
+    for(k=0; k<jobs; k++) {
+        ret = ret && !job[k].failed;
+    }
+    if(!ret) {
+        ERROR_MSG("Failed to allocate overlays.");
+    }
+    else {
+        n = 0;
+        if(ipl.load_sector_count) {
+            overlay[n].record  = (ipl.load_start_record[0] << 16) | (ipl.load_start_record[1] << 8) | ipl.load_start_record[2];
+            overlay[n].logical = ipl.load_store_address[0] | (ipl.load_store_address[1] << 8);
+            overlay[n].mode    = 1;
+            overlay[n].bank    = 0;
+            overlay[n].size    = ipl.load_sector_count * 2048;
+            if((overlay[n].logical + overlay[n].size) > 0x10000) {
+                overlay[n].size = 0x10000 - overlay[n].logical;
+            }
+            n++;
+        }
+        for(k=0; k<jobs; k++) {
+            memcpy(overlay + n, job[k].overlay, job[k].count * sizeof(cd_overlay_t));
+            n += job[k].count;
+        }
+        qsort(overlay, n, sizeof(cd_overlay_t), cd_overlay_compare);
+        for(i=1, m=(n > 0); i<n; i++) {
+            if(cd_overlay_compare(&overlay[m-1], &overlay[i])) {
+                overlay[m++] = overlay[i];
+            }
+        }
+        n = m;
+        INFO_MSG("%zu overlays found.", n);
+        ret = cd_scan_sections(&ipl, overlay, n, out, count);
+    }
+
+    for(k=0; k<jobs; k++) {
+        free(job[k].overlay);
+    }
+    free(overlay);
+    return ret;
+}
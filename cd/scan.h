@@ -0,0 +1,74 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_CD_SCAN_H
+#define ETRIPATOR_CD_SCAN_H
+
+#include "../cd.h"
+#include "../ipl.h"
+#include "../section.h"
+
+/**
+ * CD_READ call parameters.
+ */
+typedef struct {
+    uint32_t record;  /**< First record. **/
+    uint16_t logical; /**< Load address. **/
+    uint8_t  mode;    /**< Address type (_dh). **/
+    uint8_t  bank;    /**< First bank (only used for MPR modes). **/
+    int32_t  size;    /**< Size (in bytes). **/
+} cd_overlay_t;
+
+/**
+ * Retrieve the parameters of a CD_READ call from the code preceding it.
+ * The parameters must be set with immediate values. Only loads to local memory
+ * (modes 0 and 1) and to banks mapped by MPR 2 to 6 (modes 2 to 6) are reported.
+ * Local loads are clipped to the end of the logical address space.
+ * \param [in]  buffer  Code.
+ * \param [in]  call    Offset of the jsr $e009 instruction in the buffer.
+ * \param [out] overlay CD_READ parameters.
+ * eturn 1 if the parameters were found, 0 otherwise.
+ */
+int cd_scan_call(const uint8_t *buffer, size_t call, cd_overlay_t *overlay);
+
+/**
+ * Add a Code section for each overlay.
+ * The system card loads data for MPR modes one bank at a time, each bank being
+ * mapped in turn by the MPR. These loads are split into one 8KB section per bank.
+ * \param [in]     ipl     IPL header. Its memory page registers are used for the sections.
+ * \param [in]     overlay Overlays.
+ * \param [in]     n       Number of overlays.
+ * \param [in,out] out     Sections.
+ * \param [in,out] count   Section count.
+ * eturn 1 upon success, 0 if an error occured.
+ */
+int cd_scan_sections(const ipl_t *ipl, const cd_overlay_t *overlay, size_t n, section_t **out, int *count);
+
+/**
+ * Scan CDROM data track for overlays.
+ * The data track is split between worker threads and scanned sector by sector
+ * for system card CD_READ calls (jsr $e009) whose parameters are set with
+ * immediate values. A Code section is added for each load found and for the
+ * IPL boot program. The sections use the memory page registers set by the IPL.
+ * \param [in]     image CDROM image.
+ * \param [in,out] out   Sections.
+ * \param [in,out] count Section count.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int cd_scan(const cd_image_t *image, section_t **out, int *count);
+
+#endif // ETRIPATOR_CD_SCAN_H
@@ -24,18 +24,28 @@
 #include <message/console.h>
 #include <message/file.h>
 
+#include <callgraph.h>
+#include <callgraph/save.h>
 #include <cd.h>
+#include <cd/scan.h>
 #include <decode.h>
+#include <flow.h>
+#include <flow/save.h>
 #include <irq.h>
 #include <label.h>
 #include <label/load.h>
 #include <label/save.h>
 #include <memorymap.h>
+#include <mpr.h>
 #include <opcodes.h>
 #include <rom.h>
 #include <ipl.h>
 #include <section.h>
 #include <section/load.h>
+#include <section/save.h>
+#include <trace.h>
+#include <xref.h>
+#include <xref/save.h>
 
 #include "options.h"
 
@@ -44,11 +54,32 @@
  */
 void exit_callback(void) { msg_printer_destroy(); }
 
+/*
+  load labels
+*/
+static int label_input(const cli_opt_t *option, const char *filename, label_repository_t *repository) {
+    char *cache_filename = NULL;
+    int ret;
+    if(option->labels_cache) {
+        size_t len = strlen(filename) + sizeof(".cache");
+        cache_filename = (char*)malloc(len);
+        if(cache_filename == NULL) {
+            ERROR_MSG("Failed to allocate label cache filename: %s", strerror(errno));
+            return 0;
+        }
+        snprintf(cache_filename, len, "%s.cache", filename);
+    }
+    ret = label_repository_load(filename, cache_filename, repository);
+    free(cache_filename);
+    return ret;
+}
+
 /*
   output labels
 */
 int label_output(cli_opt_t *option, label_repository_t *repository) {
     char buffer[256];
+    int ret;
 
     if(NULL == option->labels_out) { 
         /* We don't want to destroy the original label file. */
@@ -66,29 +97,180 @@ int label_output(cli_opt_t *option, label_repository_t *repository) {
         snprintf(buffer, 256, "%s.%s.lbl", tmp, dateString);     
         option->labels_out = buffer;
     }
-    if (!label_repository_save(option->labels_out, repository)) {
+    ret = option->labels_compact ? label_repository_save_compact(option->labels_out, repository)
+                                 : label_repository_save(option->labels_out, repository);
+    if (!ret) {
         ERROR_MSG("Failed to write/update label file: %s", option->labels_out);
         return 0;
     }
     return 1;
 }
 
+/*
+  output control flow graph
+*/
+static int cfg_output(const cli_opt_t *option, const flow_graph_t *graph, const section_t *section, label_repository_t *repository) {
+    size_t len = strlen(option->cfg_out);
+    int ret;
+    if((len >= 4) && !strcmp(option->cfg_out + len - 4, ".dot")) {
+        ret = flow_graph_save_dot(option->cfg_out, graph, section, repository);
+    }
+    else {
+        ret = flow_graph_save_json(option->cfg_out, graph, section, repository);
+    }
+    if (!ret) {
+        ERROR_MSG("Failed to write control flow graph: %s", option->cfg_out);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+  load section data from CDROM or from an arbitrary ROM offset
+*/
+static int section_data_load(const cli_opt_t *option, const section_t *section, memmap_t *map, cd_image_t *image, cd_reader_t *reader, int *reader_open) {
+    if ((0 != option->cdrom) && (NULL != image->file.data)) {
+        /* Map CDROM data */
+        return cd_map(map, image, section->offset, section->size, section->page, section->logical);
+    }
+    if ((0 != option->cdrom) || (section->offset != ((section->page << 13) | (section->logical & 0x1fff)))) {
+        /* Copy CDROM data */
+        if (!*reader_open) {
+            *reader_open = cd_reader_open(reader, option->rom_filename);
+            if (!*reader_open) {
+                return 0;
+            }
+        }
+        return cd_load(reader, section->offset, section->size, section->page, section->logical, map);
+    }
+    return 1;
+}
+
+/*
+  "merge" a section with the previous one if they share the same output and overlap.
+  returns -1 if the section was entirely processed with the previous one, 1 if it was merged and 0 otherwise.
+*/
+static int section_merge(section_t *section, int i) {
+    if((i > 0) && (0 == strcmp(section[i].output, section[i-1].output))
+               && (section[i].page == section[i-1].page)
+               && (section[i].logical <= (section[i-1].logical + section[i-1].size))) {
+        // Adjust size if necessary.
+        uint32_t end0 = section[i-1].logical + section[i-1].size;
+        if(section[i].size > 0) {
+            uint32_t end1 = section[i].logical + section[i].size;
+            if(end1 <= end0) {
+                return -1;
+            }
+            section[i].size = end1 - end0;
+        }
+        section[i].logical = end0;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+  index of the first section written to the same file as the specified section
+*/
+static int section_output_id(const section_t *section, int i) {
+    int j;
+    for (j = 0; (j < i) && strcmp(section[j].output, section[i].output); j++) {
+    }
+    return j;
+}
+
+/*
+  follow code from the code sections and replace them with the code found
+*/
+static int section_trace(const cli_opt_t *option, memmap_t *map, cd_image_t *image, cd_reader_t *reader, int *reader_open,
+                         section_t **section, int *section_count, label_repository_t *repository) {
+    trace_t trace;
+    int i, j, ret, first, last;
+    int count = *section_count;
+    char *reached = (char*)calloc(count + 1, 1);
+    if (NULL == reached) {
+        ERROR_MSG("Failed to allocate trace entries: %s", strerror(errno));
+        return 0;
+    }
+
+    /* Overlays share memory pages. Their code is collected right after being traced. */
+    trace_init(&trace, option->cdrom);
+    for (i = 0, ret = 1; ret && (i < count); i++) {
+        if ((*section)[i].type != Code) {
+            continue;
+        }
+        ret = section_data_load(option, &(*section)[i], map, image, reader, reader_open);
+        if (!ret) {
+            ERROR_MSG("Failed to load CD data (section %d)", i);
+            break;
+        }
+        memmap_mpr(map, (*section)[i].mpr);
+        ret = trace_run(&trace, map, *section, count, i, repository);
+        reached[i] = ret && trace_reached(&trace, map, (*section)[i].logical);
+        if (ret && option->cdrom) {
+            first = *section_count;
+            ret = trace_collect(&trace, section, section_count, repository);
+            /* The bytes of the overlay that were not reached are kept. */
+            if (ret && reached[i]) {
+                ret = trace_remainder(&trace, section, section_count, i, first, *section_count, repository);
+            }
+        }
+    }
+    if (ret && !option->cdrom) {
+        first = *section_count;
+        ret = trace_collect(&trace, section, section_count, repository);
+        /* The bytes of the entry sections that were not reached are kept. */
+        for (i = 0, last = *section_count; ret && (i < count); i++) {
+            if (reached[i]) {
+                ret = trace_remainder(&trace, section, section_count, i, first, last, repository);
+            }
+        }
+    }
+    if (ret) {
+        INFO_MSG("%d code sections found.", *section_count - count);
+        /* Replace entry sections. */
+        for (i = 0, j = 0; i < *section_count; i++) {
+            if ((i < count) && reached[i]) {
+                free((*section)[i].name);
+                free((*section)[i].output);
+                continue;
+            }
+            (*section)[j++] = (*section)[i];
+        }
+        *section_count = j;
+    }
+    trace_destroy(&trace);
+    free(reached);
+    return ret;
+}
+
 /* ---------------------------------------------------------------- */
 int main(int argc, const char **argv) {
     cli_opt_t option;
 
     FILE *out;
     FILE *main_file;
-    int i;
+    int i, merged;
     int ret, failure;
 
     console_msg_printer_t console_printer;
     file_msg_printer_t file_printer;
 
     memmap_t map;
+    cd_reader_t reader;
+    int reader_open;
+    cd_image_t image;
+    insn_list_t insn_list;
+    flow_graph_t graph;
+    callgraph_t call_graph;
+    xref_table_t xref;
+    xref_label_list_t xref_labels;
+    mpr_tracker_t tracker;
+    emitter_t emitter;
 
     section_t *section;
     int section_count;
+    uint16_t irq_vector[5];
 
     atexit(exit_callback);
 
@@ -107,6 +289,16 @@ int main(int argc, const char **argv) {
     }
 
     failure = 1;
+    reader_open = 0;
+    memset(&image, 0, sizeof(cd_image_t));
+    filemap_init(&image.file);
+    insn_list_init(&insn_list);
+    flow_graph_init(&graph);
+    callgraph_init(&call_graph);
+    xref_table_init(&xref);
+    xref_label_list_init(&xref_labels);
+    mpr_tracker_init(&tracker);
+    memset(&emitter, 0, sizeof(emitter_t));
     section_count = 0;
     section = NULL;
 
@@ -133,6 +325,9 @@ int main(int argc, const char **argv) {
 
     /* Read ROM */
     if (!option.cdrom) {
+        if (NULL != option.scan_out) {
+            WARNING_MSG("Overlay scan is only available for CD images.");
+        }
         ret = rom_load(option.rom_filename, &map);
         if (!ret) {
             goto error_2;
@@ -145,12 +340,40 @@ int main(int argc, const char **argv) {
                 ERROR_MSG("An error occured while reading irq vector offsets");
                 goto error_2;
             }
+            /* Sections are sorted and may be replaced by the traced code. */
+            for (i = 0; i < 5; ++i) {
+                irq_vector[i] = section[section_count - 5 + i].logical;
+            }
         }
     } else {
         ret = cd_memmap(&map);
         if (!ret) {
             goto error_2;
         }
+        if (!cd_open(&image, option.rom_filename)) {
+            WARNING_MSG("Failed to map %s. Falling back to regular file reads.", option.rom_filename);
+        }
+
+        if (NULL != option.scan_out) {
+            section_t *overlay = NULL;
+            int overlay_count = 0;
+            if (NULL == image.file.data) {
+                ERROR_MSG("Overlay scan requires a memory mapped CD image.");
+                goto error_2;
+            }
+            ret = cd_scan(&image, &overlay, &overlay_count);
+            ret = ret && section_save(option.scan_out, overlay, overlay_count);
+            section_delete(overlay, overlay_count);
+            if (!ret) {
+                ERROR_MSG("An error occured while scanning CD overlays.");
+                goto error_2;
+            }
+            if ((NULL == option.cfg_filename) && !option.extract_irq) {
+                /* Nothing to disassemble. */
+                failure = 0;
+                goto error_2;
+            }
+        }
 
         if (option.extract_irq) {
             ipl_t ipl;
@@ -171,7 +394,7 @@ int main(int argc, const char **argv) {
     /* Load labels */
     if (NULL != option.labels_in) {
         for(i=0; option.labels_in[i]; i++) {
-            ret = label_repository_load(option.labels_in[i], repository);
+            ret = label_input(&option, option.labels_in[i], repository);
             if (!ret) {
                 ERROR_MSG("An error occured while loading labels from %s : %s", option.labels_in[i], strerror(errno));
                 goto error_4;
@@ -179,6 +402,16 @@ int main(int argc, const char **argv) {
         }
     }
 
+    /* Follow code from entry points */
+    if (option.trace) {
+        ret = section_trace(&option, &map, &image, &reader, &reader_open, &section, &section_count, repository);
+        if (!ret) {
+            ERROR_MSG("An error occured while tracing code.");
+            goto error_4;
+        }
+        section_sort(section, section_count);
+    }
+
     /* For each section reset every existing files */
     for (i = 0; i < section_count; ++i) {
         out = fopen(section[i].output, "wb");
@@ -198,21 +431,31 @@ int main(int argc, const char **argv) {
         }
     }
 
+    if (!emitter_init(&emitter)) {
+        goto error_4;
+    }
+
     /* Disassemble and output */
     for (i = 0; i < section_count; ++i) {
-        out = fopen(section[i].output, "ab");
+        /* Output files were created above. They are not opened in append mode so that binary data can be copied straight from the input file. */
+        out = fopen(section[i].output, "r+b");
         if (!out) {
             ERROR_MSG("Can't open %s : %s", section[i].output, strerror(errno));
             goto error_4;
         }
+        if (fseek(out, 0, SEEK_END)) {
+            ERROR_MSG("Can't seek %s : %s", section[i].output, strerror(errno));
+            fclose(out);
+            out = NULL;
+            goto error_4;
+        }
+        emitter_reset(&emitter, out);
+        xref_labels.file = (uint32_t)section_output_id(section, i);
 
-        if ((0 != option.cdrom) || (section[i].offset != ((section[i].page << 13) | (section[i].logical & 0x1fff)))) {
-            /* Copy CDROM data */
-            ret = cd_load(option.rom_filename, section[i].offset, section[i].size, section[i].page, section[i].logical, &map);
-            if (0 == ret) {
-                ERROR_MSG("Failed to load CD data (section %d)", i);
-                goto error_4;
-            }
+        ret = section_data_load(&option, &section[i], &map, &image, &reader, &reader_open);
+        if (0 == ret) {
+            ERROR_MSG("Failed to load CD data (section %d)", i);
+            goto error_4;
         }
 
         if((i > 0) && (section[i].logical < (section[i-1].logical + section[i-1].size))
@@ -221,64 +464,73 @@ int main(int argc, const char **argv) {
             WARNING_MSG("Section %s and %s overlaps! %x %x.%x", section[i].name, section[i-1].name);
         }
 
-        if((i > 0) && (0 == strcmp(section[i].output, section[i-1].output))
-                   && (section[i].page == section[i-1].page)
-                   && (section[i].logical <= (section[i-1].logical + section[i-1].size))) {
-            // "Merge" sections and adjust size if necessary.
-            if(section[i].size > 0) {
-                uint32_t end0 = section[i-1].logical + section[i-1].size;
-                uint32_t end1 = section[i].logical + section[i].size;
-                if(end1 > end0) {
-                    section[i].size = end1 - end0;
-                    section[i].logical = end0;
-                    INFO_MSG("Section %s has been merged with %s!", section[i].name, section[i-1].name);
-                }
-                else {
-                    // The previous section overlaps the current one.
-                    // We skip it as it has already been processed.
-                    fclose(out);
-                    out = NULL;
-                    continue;
-                }
-            }
-            else {
-                section[i].logical = section[i-1].logical + section[i-1].size;
-                INFO_MSG("Section %s has been merged with %s!", section[i].name, section[i-1].name);
-            }
+        merged = section_merge(section, i);
+        if(merged < 0) {
+            // The previous section overlaps the current one.
+            // We skip it as it has already been processed.
+            fclose(out);
+            out = NULL;
+            continue;
+        }
+        if(merged) {
+            INFO_MSG("Section %s has been merged with %s!", section[i].name, section[i-1].name);
         }
         else if((section[i].type != Data) || (section[i].data.type != Binary)) {
             /* Print header */
-            fprintf(out, "\t.%s\n"
-                         "\t.bank $%03x\n"
-                         "\t.org $%04x\n",
-                    (section[i].type == Code) ? "code" : "data", section[i].page, section[i].logical);
+            emitter_printf(&emitter, "\t.%s\n"
+                                     "\t.bank $%03x\n"
+                                     "\t.org $%04x\n",
+                           (section[i].type == Code) ? "code" : "data", section[i].page, section[i].logical);
         }
 
         memmap_mpr(&map, section[i].mpr);
        
         if (section[i].type == Code) {
+            insn_list_reset(&insn_list);
             if(section[i].size <= 0) {
-                section[i].size = compute_size(section, i, section_count, &map);
+                section[i].size = compute_size(section, i, section_count, &map, &insn_list);
             }
 
+            /* Decode instructions */
+            ret = insn_list_build(&insn_list, &section[i], &map);
+            if (!ret) {
+                goto error_4;
+            }
+            /* Follow memory page register changes */
+            if (option.track_mpr && (mpr_propagate(&tracker, &section[i], &insn_list) < 0)) {
+                goto error_4;
+            }
             /* Extract labels */
-            ret = label_extract(&section[i], &map, repository);
+            ret = label_extract(&section[i], &insn_list, repository);
             if (!ret) {
                 goto error_4;
             }
+            /* Split code into basic blocks */
+            if (option.cfg_out && !flow_graph_add(&graph, &section[i], i, &insn_list)) {
+                goto error_4;
+            }
+            /* Record subroutine calls */
+            if (option.call_graph_out && !callgraph_add(&call_graph, &insn_list)) {
+                goto error_4;
+            }
             /* Process opcodes */
-            uint16_t logical = section[i].logical;
-            do {
-                (void)decode(out, &logical, &section[i], &map, repository);
-            } while (logical < (section[i].logical+section[i].size));
-            fputc('\n', out);
+            for (size_t j = 0; j < insn_list.count; j++) {
+                if ((option.xref_out || option.xref_count) && !insn_xref(&xref, &insn_list.insn[j], &map)) {
+                    goto error_4;
+                }
+                (void)decode(&emitter, &insn_list.insn[j], &map, repository, option.xref_count ? &xref_labels : NULL);
+            }
+            emitter_char(&emitter, '\n');
         } else {
-            ret = data_extract(out, &section[i], &map, repository);
+            ret = data_extract(&emitter, &section[i], &map, repository, option.xref_count ? &xref_labels : NULL);
             if (!ret) {
                 // [todo]
             }
         }
 
+        if (!emitter_flush(&emitter)) {
+            ERROR_MSG("Failed to write %s", section[i].output);
+        }
         fclose(out);
         out = NULL;
     }
@@ -293,12 +545,46 @@ int main(int argc, const char **argv) {
     if (!option.cdrom && option.extract_irq) {
         fprintf(main_file, "\n\t.data\n\t.bank 0\n\t.org $FFF6\n");
         for (i = 0; i < 5; ++i) {
-            fprintf(main_file, "\t.dw $%04x\n", section[i].logical);
+            fprintf(main_file, "\t.dw $%04x\n", irq_vector[i]);
         }
     }
 
     fclose(main_file);
 
+    /* Output control flow graph */
+    if (option.cfg_out && !cfg_output(&option, &graph, section, repository)) {
+        goto error_4;
+    }
+
+    /* Output call graph */
+    if (option.call_graph_out) {
+        if (!callgraph_build(&call_graph) || !callgraph_save(option.call_graph_out, &call_graph, repository)) {
+            ERROR_MSG("Failed to write call graph: %s", option.call_graph_out);
+            goto error_4;
+        }
+    }
+
+    /* Output cross references */
+    if (option.xref_out) {
+        if (!xref_table_sort(&xref) || !xref_table_save(option.xref_out, &xref, repository)) {
+            ERROR_MSG("Failed to write cross references: %s", option.xref_out);
+            goto error_4;
+        }
+    }
+
+    /* Annotate labels with the number of references found in the whole code */
+    if (option.xref_count) {
+        if (xref_labels.error || !xref_table_sort(&xref)) {
+            ERROR_MSG("An error occured while recording cross references.");
+            goto error_4;
+        }
+        for (i = 0; i < section_count; i++) {
+            if ((section_output_id(section, i) == i) && !xref_annotate(section[i].output, &xref_labels, (uint32_t)i, &xref)) {
+                goto error_4;
+            }
+        }
+    }
+
     /* Output labels  */
     if (!label_output(&option, repository)) {
         goto error_4;
@@ -306,9 +592,20 @@ int main(int argc, const char **argv) {
     failure = 0;
 
 error_4:
+    emitter_destroy(&emitter);
     label_repository_destroy(repository);
 error_2:
+    mpr_tracker_destroy(&tracker);
+    xref_table_destroy(&xref);
+    xref_label_list_destroy(&xref_labels);
+    callgraph_destroy(&call_graph);
+    flow_graph_destroy(&graph);
+    insn_list_destroy(&insn_list);
+    if (reader_open) {
+        cd_reader_close(&reader);
+    }
     memmap_destroy(&map);
+    cd_close(&image);
 error_1:
     if(option.labels_in) {
         free(option.labels_in);
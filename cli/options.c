@@ -57,7 +57,16 @@ int get_cli_opt(int argc, const char** argv, cli_opt_t* option) {
         OPT_BOOLEAN('c', "cd", &option->cdrom, "cdrom image disassembly. Irq detection and rom. Header jump is not performed", NULL, 0, 0),
         OPT_STRING('o', "out", &option->main_filename, "main asm file containing includes for all sections as long the irq vector table if the irq-detect option is enabled", NULL, 0, 0),
         OPT_STRING('l', "labels", &dummy, "labels definition filename", labels_opt_callback, (intptr_t)&payload, 0),
+        OPT_BOOLEAN(0, "labels-cache", &option->labels_cache, "read the labels definition files from binary caches (<file>.cache), and write them if they are missing or outdated", NULL, 0, 0),
         OPT_STRING(0, "labels-out", &option->labels_out, "extracted labels output filename. Otherwise the labels will be written to <in>.YYMMDDhhmmss.lbl", NULL, 0, 0),
+        OPT_STRING(0, "cd-scan", &option->scan_out, "scan the whole cdrom data track for overlays loaded with immediate CD_READ parameters and write the sections found to the specified file", NULL, 0, 0),
+        OPT_BOOLEAN('t', "trace", &option->trace, "follow jumps and subroutine calls from the code sections (irq vectors, IPL entry point or configuration) and replace them with the code found", NULL, 0, 0),
+        OPT_STRING(0, "cfg", &option->cfg_out, "write the control flow graph of the code sections to the specified file (Graphviz DOT if the name ends with .dot, JSON otherwise)", NULL, 0, 0),
+        OPT_STRING(0, "call-graph", &option->call_graph_out, "write the subroutine call graph of the code sections to the specified JSON file", NULL, 0, 0),
+        OPT_STRING(0, "xref", &option->xref_out, "write the cross references of the code sections to the specified JSON file", NULL, 0, 0),
+        OPT_BOOLEAN(0, "xref-count", &option->xref_count, "annotate each label with the number of instructions referencing it", NULL, 0, 0),
+        OPT_BOOLEAN('m', "track-mpr", &option->track_mpr, "follow the memory page registers set with tam along the code and use them to resolve the bank of jmp and jsr targets", NULL, 0, 0),
+        OPT_BOOLEAN(0, "labels-compact", &option->labels_compact, "write extracted labels as a single line JSON array", NULL, 0, 0),
         OPT_END(),
     };
 
@@ -68,6 +77,16 @@ int get_cli_opt(int argc, const char** argv, cli_opt_t* option) {
     option->cfg_filename  = NULL;
     option->rom_filename  = NULL;
     option->main_filename = "main.asm";
+    option->labels_out = NULL;
+    option->labels_compact = 0;
+    option->labels_cache = 0;
+    option->scan_out = NULL;
+    option->trace = 0;
+    option->cfg_out = NULL;
+    option->call_graph_out = NULL;
+    option->xref_out = NULL;
+    option->xref_count = 0;
+    option->track_mpr = 0;
     option->labels_in = NULL;
 
     argparse_init(&argparse, options, usages, 0);
@@ -78,8 +97,8 @@ int get_cli_opt(int argc, const char** argv, cli_opt_t* option) {
         return 0;
     }
     if(argc != 2) {
-        if((option->extract_irq) && (argc == 1)) {
-            /* Config file is optional with automatic irq vector extraction. */
+        if((option->extract_irq || option->scan_out) && (argc == 1)) {
+            /* Config file is optional with automatic irq vector extraction or overlay scan. */
             option->cfg_filename =  NULL;
             option->rom_filename = argv[0];
         }
@@ -28,6 +28,15 @@ typedef struct {
     const char *rom_filename;
     const char *main_filename;
     const char *labels_out;
+    int labels_compact;
+    int labels_cache;
+    const char *scan_out;
+    int trace;
+    const char *cfg_out;
+    const char *call_graph_out;
+    const char *xref_out;
+    int xref_count;
+    int track_mpr;
     const char **labels_in;
 } cli_opt_t;
 
@@ -19,87 +19,311 @@
 #include "message.h"
 #include "opcodes.h"
 
+/* Reads the instruction at the specified logical address. The opcode is stored in bytes[0] followed by its operands. */
+static const opcode_t* instruction_fetch(memmap_t *map, uint16_t logical, uint8_t *bytes) {
+    const opcode_t *opcode;
+    const uint8_t *src;
+    size_t len = 8;
+    int i;
+
+    src = memmap_span(map, logical, &len);
+    bytes[0] = src ? src[0] : 0xff;
+    opcode = opcode_get(bytes[0]);
+    if(len >= opcode->size) {
+        for(i=1; i<opcode->size; i++) {
+            bytes[i] = src ? src[i] : 0xff;
+        }
+    }
+    else {
+        /* The instruction crosses a page boundary. */
+        for(i=1; i<opcode->size; i++) {
+            bytes[i] = memmap_read(map, (uint16_t)(logical + i));
+        }
+    }
+    return opcode;
+}
+
 /**
- * Finds any jump address from the current section.
+ * Decodes a single instruction.
+ * @param [out] insn Decoded instruction.
+ * @param [in] map Memory map.
+ * @param [in] logical Logical address.
+ * @return Opcode description.
+ */
+const opcode_t* insn_decode(insn_t *insn, memmap_t *map, uint16_t logical) {
+    const opcode_t *opcode = instruction_fetch(map, logical, insn->data);
+    uint8_t inst = insn->data[0];
+    insn->logical = logical;
+    insn->page = memmap_page(map, logical);
+    insn->size = opcode->size;
+    insn->target = 0;
+    insn->target_page = 0;
+    if(opcode_is_local_jump(inst)) {
+        int delta;
+        /* For BBR* and BBS* displacement is stored in the 2nd byte */
+        int i = ((inst & 0x0F) == 0x0F) ? 2 : 1;
+        /* Detect negative number */
+        if(insn->data[i] & 128) {
+            delta = -((insn->data[i] - 1) ^ 0xff);
+        } else {
+            delta = insn->data[i];
+        }
+        insn->target = logical + opcode->size + delta;
+        insn->target_page = memmap_page(map, insn->target);
+    } else if(opcode_is_far_jump(inst)) {
+        insn->target = insn->data[1] | (insn->data[2] << 8);
+        insn->target_page = memmap_page(map, insn->target);
+    }
+    return opcode;
+}
+
+/* Appends an instruction to the list. */
+static int insn_list_push(insn_list_t *list, const insn_t *insn) {
+    if(list->count >= list->capacity) {
+        size_t capacity = list->capacity ? (list->capacity * 2) : 256;
+        insn_t *tmp = (insn_t*)realloc(list->insn, capacity * sizeof(insn_t));
+        if(tmp == NULL) {
+            ERROR_MSG("Failed to allocate instructions: %s", strerror(errno));
+            return 0;
+        }
+        list->insn = tmp;
+        list->capacity = capacity;
+    }
+    list->insn[list->count++] = *insn;
+    return 1;
+}
+
+/**
+ * Initializes instruction list.
+ * @param [out] list Instruction list.
+ */
+void insn_list_init(insn_list_t *list) {
+    list->insn = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/**
+ * Removes all instructions from the list. The storage is kept for the next section.
+ * @param [in out] list Instruction list.
+ */
+void insn_list_reset(insn_list_t *list) {
+    list->count = 0;
+}
+
+/**
+ * Releases instruction list storage.
+ * @param [in out] list Instruction list.
+ */
+void insn_list_destroy(insn_list_t *list) {
+    free(list->insn);
+    insn_list_init(list);
+}
+
+/**
+ * Decodes the instructions of a code section.
+ * Instructions already in the list (see compute_size) are kept and decoding resumes after the last one.
+ * @param [in out] list Instruction list.
  * @param [in] section Current section.
  * @param [in] map Memory map.
- * @param [in out] repository Label repository.
  * @return 1 upon success, 0 otherwise.
  */
-int label_extract(section_t *section, memmap_t *map, label_repository_t *repository) {
-	int i;
-	uint8_t inst;
-	uint8_t data[6];
-	char buffer[32];
-
-	uint16_t logical;
-	uint8_t page;
+int insn_list_build(insn_list_t *list, section_t *section, memmap_t *map) {
+    insn_t insn;
+    uint16_t logical = section->logical;
+    if(list->count) {
+        const insn_t *last = &list->insn[list->count - 1];
+        logical = last->logical + last->size;
+    }
+    else {
+        insn_decode(&insn, map, logical);
+        if(!insn_list_push(list, &insn)) {
+            return 0;
+        }
+        logical += insn.size;
+    }
+    while(logical < (section->logical + section->size)) {
+        insn_decode(&insn, map, logical);
+        if(!insn_list_push(list, &insn)) {
+            return 0;
+        }
+        logical += insn.size;
+    }
+    return 1;
+}
 
-    const opcode_t *opcode;
+/**
+ * Finds any jump address from the current section.
+ * @param [in] section Current section.
+ * @param [in] list Section instructions.
+ * @param [in out] repository Label repository.
+ * @return 1 upon success, 0 otherwise.
+ */
+int label_extract(section_t *section, const insn_list_t *list, label_repository_t *repository) {
+	int ret;
+	size_t i, count, capacity;
+	label_address_t *targets;
 
-	if (section->type != Code) {
+	if ((section->type != Code) || (section->size <= 0)) {
 		return 1;
 	}
 
+	count = 0;
+	capacity = 64;
+	targets = (label_address_t*)malloc(capacity * sizeof(label_address_t));
+	if (targets == NULL) {
+		ERROR_MSG("Failed to allocate jump targets: %s", strerror(errno));
+		return 0;
+	}
+
 	/* Walk along section */
-    for(logical = section->logical; logical < (section->logical + section->size); logical += opcode->size) {
-		/* Read instruction */
-		inst = memmap_read(map, logical);
-		opcode = opcode_get(inst);
-		/* Read data (if any) */
-		for (i = 0; i < (opcode->size - 1); i++) {
-			data[i] = memmap_read(map, logical + i + 1);
+	for (i = 0; i < list->count; i++) {
+		const insn_t *insn = &list->insn[i];
+		if (opcode_is_local_jump(insn->data[0])) {
+			INFO_MSG("%04x short jump to %04x (%02x)", insn->logical, insn->target, insn->target_page);
+		} else if (opcode_is_far_jump(insn->data[0])) {
+			INFO_MSG("%04x long jump to %04x (%02x)", insn->logical, insn->target, insn->target_page);
+		} else {
+			continue;
 		}
 
-		if (opcode_is_local_jump(inst)) {
-			uint16_t jump;
-			int delta;
-			/* For BBR* and BBS* displacement is stored in the 2nd byte */
-			i = (((inst)&0x0F) == 0x0F) ? 1 : 0;
-			/* Detect negative number */
-			if (data[i] & 128) {
-				delta = -((data[i] - 1) ^ 0xff);
-			} else {
-				delta = data[i];
-			}
-			delta += opcode->size;
-			jump = logical + delta;
-			page = memmap_page(map, jump);
-			/* Create label name */
-			snprintf(buffer, 32, "l%04x_%02d", jump, page);
-
-			/* Insert offset to repository */
-			if (!label_repository_add(repository, buffer, jump, page)) {
+		/* Jump targets are added to the repository all at once when the whole section has been processed. */
+		if (count >= capacity) {
+			label_address_t *tmp;
+			capacity *= 2;
+			tmp = (label_address_t*)realloc(targets, capacity * sizeof(label_address_t));
+			if (tmp == NULL) {
+				ERROR_MSG("Failed to allocate jump targets: %s", strerror(errno));
+				free(targets);
 				return 0;
 			}
-			INFO_MSG("%04x short jump to %04x (%02x)", logical, jump, page);
-		} else if (opcode_is_far_jump(inst)) {
-				uint16_t jump = data[0] | (data[1] << 8);
-				page = memmap_page(map, jump);
-				/* Create label name */
-				snprintf(buffer, 32, "l%04x_%02d", jump, page);
-				/* Insert offset to repository */
-				if (!label_repository_add(repository, buffer, jump, page)) {
-					return 0;
-				}
-
-				INFO_MSG("%04x long jump to %04x (%02x)", logical, jump, page);
+			targets = tmp;
 		}
+		targets[count].logical = insn->target;
+		targets[count].page = insn->target_page;
+		count++;
 	}
-	return 1;
+
+	ret = label_repository_add_batch(repository, targets, count);
+	free(targets);
+	return ret;
+}
+
+/* Outputs a label definition. Its position is recorded if the label must be annotated with its reference count. */
+static void label_emit(emitter_t *out, const char *name, uint16_t logical, uint8_t page, xref_label_list_t *labels) {
+    emitter_string(out, name);
+    emitter_char(out, ':');
+    if(labels) {
+        (void)xref_label_list_push(labels, emitter_tell(out), logical, page);
+    }
+}
+
+/**
+ * Walks labels in address order along a data section.
+ */
+typedef struct {
+    label_repository_t *repository;
+    int cursor;        /**< Repository cursor. **/
+    uint8_t page;      /**< Memory page of the current 8KB window. **/
+    uint16_t start;    /**< Start of the current 8KB window. **/
+    int valid;         /**< Set if a label was found in the current window. **/
+    uint16_t logical;  /**< Logical address of the next label. **/
+    char *name;        /**< Name of the next label. **/
+} label_walk_t;
+
+static void label_walk_seek(label_walk_t *walk, memmap_t *map, uint16_t logical) {
+    walk->page = memmap_page(map, logical);
+    walk->start = logical & 0xe000;
+    walk->cursor = label_repository_seek(walk->repository, logical, walk->page);
+    walk->valid = label_repository_next_in_range(walk->repository, &walk->cursor, walk->start + 0x2000, walk->page, &walk->logical, &walk->name);
 }
 
-static int data_extract_binary(FILE *out, section_t *section, memmap_t *map, label_repository_t *repository) {
+static void label_walk_init(label_walk_t *walk, label_repository_t *repository, memmap_t *map, uint16_t logical) {
+    walk->repository = repository;
+    label_walk_seek(walk, map, logical);
+}
+
+/* Addresses must be visited in increasing order (modulo the 64KB wrap around). */
+static int label_walk_at(label_walk_t *walk, memmap_t *map, uint16_t logical, char **name) {
+    if((logical & 0xe000) != walk->start) {
+        label_walk_seek(walk, map, logical);
+    }
+    while(walk->valid && (walk->logical < logical)) {
+        walk->valid = label_repository_next_in_range(walk->repository, &walk->cursor, walk->start + 0x2000, walk->page, &walk->logical, &walk->name);
+    }
+    if(walk->valid && (walk->logical == logical)) {
+        *name = walk->name;
+        walk->valid = label_repository_next_in_range(walk->repository, &walk->cursor, walk->start + 0x2000, walk->page, &walk->logical, &walk->name);
+        return 1;
+    }
+    return 0;
+}
+
+/* Number of bytes before the next label of the current window. label_walk_at must have been called for this address. */
+static size_t label_walk_distance(const label_walk_t *walk, uint16_t logical) {
+    return walk->valid ? (size_t)(walk->logical - logical) : 0x2000;
+}
+
+/* Finds the file mapping the memory block belongs to. ROM pages overwritten by CDROM or file offset loads are not copied from the file. */
+static const filemap_t* data_source(memmap_t *map, uint8_t page, const uint8_t *src, size_t len, size_t *offset) {
+    if(!map->rewritten[page] && filemap_contains(&map->rom, src, len, offset)) {
+        return &map->rom;
+    }
+    if(map->cd && filemap_contains(map->cd, src, len, offset)) {
+        return map->cd;
+    }
+    return NULL;
+}
+
+static int data_extract_binary(emitter_t *out, section_t *section, memmap_t *map) {
+    uint8_t unmapped[256];
     uint16_t logical;
     int32_t i;
-    for (i=0, logical=section->logical; i < section->size; i++, logical++) {
-        uint8_t data = memmap_read(map, logical);
-        fwrite(&data, 1, 1, out);
+    /* Pending file copy. Consecutive spans of the same file are copied at once. */
+    const filemap_t *file = NULL;
+    size_t file_offset = 0, file_len = 0;
+
+    memset(unmapped, 0xff, sizeof(unmapped));
+    for (i=0, logical=section->logical; i < section->size; ) {
+        size_t len = section->size - i;
+        const uint8_t *src = memmap_span(map, logical, &len);
+        size_t offset = 0;
+        const filemap_t *source = src ? data_source(map, memmap_page(map, logical), src, len, &offset) : NULL;
+        if(file && ((source != file) || (offset != (file_offset + file_len)))) {
+            if(!emitter_flush(out) || !filemap_copy(file, file_offset, file_len, out->out)) {
+                return 0;
+            }
+            file = NULL;
+        }
+        if(source) {
+            if(file == NULL) {
+                file = source;
+                file_offset = offset;
+                file_len = 0;
+            }
+            file_len += len;
+        }
+        else if(src) {
+            emitter_write(out, src, len);
+        }
+        else {
+            size_t n;
+            for(n=0; n<len; n+=sizeof(unmapped)) {
+                emitter_write(out, unmapped, ((len-n) < sizeof(unmapped)) ? (len-n) : sizeof(unmapped));
+            }
+        }
+        i += (int32_t)len;
+        logical += (uint16_t)len;
+    }
+    if(file) {
+        if(!emitter_flush(out) || !filemap_copy(file, file_offset, file_len, out->out)) {
+            return 0;
+        }
     }
     return 1;
 }
 
-static int data_extract_hex(FILE *out, section_t *section, memmap_t *map, label_repository_t *repository) {
+static int data_extract_hex(emitter_t *out, section_t *section, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels) {
 	int32_t i, j, k;
     uint16_t logical;
     uint8_t data[2];
@@ -107,188 +331,364 @@ static int data_extract_hex(FILE *out, section_t *section, memmap_t *map, label_
 	int32_t elements_per_line = section->data.elements_per_line;
     const char *data_decl = (element_size > 1) ? ".dw" : ".db";
     char *name = "";
-    
+    label_walk_t walk;
+    const uint8_t *src = NULL;
+    size_t avail = 0;
+    uint8_t unmapped[256];
+
+    memset(unmapped, 0xff, sizeof(unmapped));
+    label_walk_init(&walk, repository, map, section->logical);
     for(i=0, j=0, k=0, logical=section->logical; i<section->size; i++, logical++) {
-        uint8_t page = memmap_page(map, logical);
-        if(label_repository_find(repository, logical, page, &name)) {
+        if(label_walk_at(&walk, map, logical, &name)) {
             if(k && (k < element_size)) {
-                fprintf(out, "\n          .db");
+                emitter_write(out, "\n          .db", 14);
                 for(j=0; j<k; j++) {
-                    fprintf(out, "%c$%02x", j ? ',' : ' ', data[j]);
+                    emitter_write(out, j ? ",$" : " $", 2);
+                    emitter_hex8(out, data[j]);
                 }
                 k = 0;
             }
             if(i) {
-                fputc('\n', out);
+                emitter_char(out, '\n');
             }
-            fprintf(out, "%s:", name);
+            label_emit(out, name, logical, walk.page, labels);
             j = 0;
         }
-        data[k++] = memmap_read(map, logical);
+        if(avail == 0) {
+            avail = section->size - i;
+            src = memmap_span(map, logical, &avail);
+        }
+        if(k == 0) {
+            /* Output whole elements up to the next label at once. */
+            size_t run = label_walk_distance(&walk, logical);
+            size_t n;
+            if(run > avail) {
+                run = avail;
+            }
+            n = run / element_size;
+            if(src == NULL) {
+                n = (n < (sizeof(unmapped)/element_size)) ? n : (sizeof(unmapped)/element_size);
+            }
+            if(n) {
+                const uint8_t *ptr = src ? src : unmapped;
+                size_t len = n * element_size;
+                while(n) {
+                    size_t count = elements_per_line - j;
+                    if(count > n) {
+                        count = n;
+                    }
+                    if(count > EMITTER_HEX_MAX) {
+                        count = EMITTER_HEX_MAX;
+                    }
+                    if(j == 0) {
+                        emitter_write(out, "\n          ", 11);
+                        emitter_write(out, data_decl, 3);
+                        emitter_char(out, ' ');
+                    }
+                    else {
+                        emitter_char(out, ',');
+                    }
+                    emitter_hex_list(out, ptr, count, element_size);
+                    ptr += count * element_size;
+                    n -= count;
+                    j = (j + (int32_t)count) % elements_per_line;
+                }
+                if(src) {
+                    src += len;
+                }
+                avail -= len;
+                /* The loop increment accounts for the last byte. */
+                i += (int32_t)len - 1;
+                logical += (uint16_t)(len - 1);
+                continue;
+            }
+        }
+        data[k++] = src ? *src++ : 0xff;
+        avail--;
         if(k >= element_size) {
             char c;
             if(j == 0) {
-                fprintf(out, "\n          %s", data_decl);
+                emitter_write(out, "\n          ", 11);
+                emitter_write(out, data_decl, 3);
                 c = ' ';
             }
             else {
                 c = ',';
             }
-            fprintf(out, "%c$", c);
+            emitter_char(out, c);
+            emitter_char(out, '$');
             while(k--) {
-                fprintf(out, "%02x", data[k]);
+                emitter_hex8(out, data[k]);
             }
             k = 0;
             j = (j+1) % elements_per_line;
         }
     }
     if(k) {
-        fprintf(out, "\n          .db ");
+        emitter_write(out, "\n          .db ", 15);
         for(j=0; j<k; j++) {
-            fprintf(out, "$%02x%c", data[j], ((j+1)<k) ? ',' : '\n');
+            emitter_char(out, '$');
+            emitter_hex8(out, data[j]);
+            emitter_char(out, ((j+1)<k) ? ',' : '\n');
         }
     }
-    fputc('\n', out);
+    emitter_char(out, '\n');
     return 1;
 }
 
-static int data_extract_string(FILE *out, section_t *section, memmap_t *map, label_repository_t *repository) {
-	int32_t i, j, k;
+static int data_extract_string(emitter_t *out, section_t *section, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels) {
+	int32_t i, j;
     uint16_t logical;
 	int32_t elements_per_line = section->data.elements_per_line;
     char *name = "";
     char c;
-    
-    for(i=0, j=0, k=0, c=0, logical=section->logical; i<section->size; i++, logical++) {
+    label_walk_t walk;
+    const uint8_t *src = NULL;
+    size_t avail = 0;
+
+    label_walk_init(&walk, repository, map, section->logical);
+    for(i=0, j=0, c=0, logical=section->logical; i<section->size; i++, logical++) {
         uint8_t data;
-        uint8_t page = memmap_page(map, logical);
-        if(label_repository_find(repository, logical, page, &name)) {
+        if(label_walk_at(&walk, map, logical, &name)) {
             if(j) {
                 if(c) {
-                    fputc('"', out);
+                    emitter_char(out, '"');
                 }
-                fputc('\n', out);
+                emitter_char(out, '\n');
             }
-            fprintf(out, "%s:", name);
+            label_emit(out, name, logical, walk.page, labels);
             j = 0;
             c = 0;
         }
-        data = memmap_read(map, logical);
+        if(avail == 0) {
+            avail = section->size - i;
+            src = memmap_span(map, logical, &avail);
+        }
         if(j == 0) {
             if(c) {
-                fputc('"', out);
+                emitter_char(out, '"');
             }
-            fprintf(out, "\n          db ");
+            emitter_write(out, "\n          db ", 14);
             c = 0;
         }
-        
+        if(src) {
+            /* Copy printable characters up to the next label or the end of the line at once. */
+            size_t run = label_walk_distance(&walk, logical);
+            size_t n;
+            if(run > avail) {
+                run = avail;
+            }
+            if(run > (size_t)(elements_per_line - j)) {
+                run = elements_per_line - j;
+            }
+            n = emitter_printable_length(src, run);
+            if(n) {
+                if(c == 0) {
+                    emitter_char(out, '"');
+                    c = 1;
+                }
+                emitter_escaped(out, src, n);
+                src += n;
+                avail -= n;
+                j = (j + (int32_t)n) % elements_per_line;
+                /* The loop increment accounts for the last character. */
+                i += (int32_t)n - 1;
+                logical += (uint16_t)(n - 1);
+                continue;
+            }
+        }
+        data = src ? *src++ : 0xff;
+        avail--;
+
         j = (j+1) % elements_per_line;
         
         if((data >= 0x20) && (data < 0x7f)) {
             if(c == 0) {
-                fputc('"', out);
+                emitter_char(out, '"');
                 c = 1;
             }
             if(data == '"') {
-                fputc('\\', out);
+                emitter_char(out, '\\');
             }
-            fputc(data, out);
+            emitter_char(out, (char)data);
         }
         else {
             if(c) {
-               fprintf(out, "\",");
+               emitter_write(out, "\",", 2);
                c = 0;
             }
-            fprintf(out, "$%02x%c", data, j ? ',' : ' ');
+            emitter_char(out, '$');
+            emitter_hex8(out, data);
+            emitter_char(out, j ? ',' : ' ');
         }
     }
     if((j || (i >= section->size)) && c) {
-        fputc('"', out);
-        fputc('\n', out);
+        emitter_char(out, '"');
+        emitter_char(out, '\n');
     }
-    fputc('\n', out);
+    emitter_char(out, '\n');
     return 1;
 }
 
 /**
  * Process data section. The result will be output has a binary file or an asm file containing hex values or strings.
- * @param [out] out File output.
+ * @param [out] out Output emitter.
  * @param [in] section Current section.
  * @param [in] map Memory map.
  * @param [in] repository Label repository.
+ * @param [in out] labels Label definitions to annotate with their reference count (optional).
  * @return 1 upon success, 0 otherwise.
  */
-int data_extract(FILE *out, section_t *section, memmap_t *map, label_repository_t *repository) {
+int data_extract(emitter_t *out, section_t *section, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels) {
     switch(section->data.type) {
         case Binary:
-            return data_extract_binary(out, section, map, repository);
+            return data_extract_binary(out, section, map);
         case Hex:
-            return data_extract_hex(out, section, map, repository);
+            return data_extract_hex(out, section, map, repository, labels);
         case String:
-            return data_extract_string(out, section, map, repository);
+            return data_extract_string(out, section, map, repository, labels);
     }
     return 0;
 }
 
 static const char *spacing = "          ";
 
+/* Address of an operand, the page is given by the current memory page registers. */
+static inline uint32_t xref_operand(memmap_t *map, uint16_t logical) {
+    return xref_address(logical, memmap_page(map, logical));
+}
+
+#define XREF_NAME(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+
+/* Access kind of the memory operand of an instruction. */
+static uint8_t xref_access(const opcode_t *opcode) {
+    switch(XREF_NAME(opcode->name[0], opcode->name[1], opcode->name[2])) {
+        case XREF_NAME('s','t','a'):
+        case XREF_NAME('s','t','x'):
+        case XREF_NAME('s','t','y'):
+        case XREF_NAME('s','t','z'):
+            return XrefWrite;
+        case XREF_NAME('i','n','c'):
+        case XREF_NAME('d','e','c'):
+        case XREF_NAME('a','s','l'):
+        case XREF_NAME('l','s','r'):
+        case XREF_NAME('r','o','l'):
+        case XREF_NAME('r','o','r'):
+        case XREF_NAME('t','s','b'):
+        case XREF_NAME('t','r','b'):
+        case XREF_NAME('r','m','b'):
+        case XREF_NAME('s','m','b'):
+            return XrefModify;
+        default:
+            return XrefRead;
+    }
+}
+
 /**
- * Process code section.
- * @param [out] out File output.
- * @param [in out] logical Current logical address.
- * @param [in] section Current section.
- * @param [in] map Memory map.
+ * Appends the memory references of an instruction to the cross reference table.
+ * @param [in out] table Cross reference table.
+ * @param [in] insn Decoded instruction.
+ * @param [in] map Memory map.
+ * @return 1 upon success, 0 otherwise.
+ */
+int insn_xref(xref_table_t *table, const insn_t *insn, memmap_t *map) {
+    const uint8_t *data = insn->data;
+    const opcode_t *opcode = opcode_get(data[0]);
+    uint32_t source = xref_address(insn->logical, insn->page);
+    uint8_t inst = data[0];
+    int ret = 1;
+
+    if(opcode_is_local_jump(inst) || opcode_is_far_jump(inst)) {
+        /* BBR* and BBS* test a zero page variable */
+        if((inst & 0x0f) == 0x0f) {
+            ret = xref_table_push(table, xref_operand(map, 0x2000 + data[1]), source, XrefRead);
+        }
+        /* The target page was resolved when the instruction was decoded. */
+        return ret && xref_table_push(table, xref_address(insn->target, insn->target_page), source, ((inst == 0x20) || (inst == 0x44)) ? XrefCall : XrefJump);
+    }
+
+    switch(opcode->type) {
+        case PCE_OP_nn_ZZ:
+        case PCE_OP_nn_ZZ_X:
+            return xref_table_push(table, xref_operand(map, 0x2000 + data[2]), source, XrefRead);
+        case PCE_OP_nn_hhll:
+        case PCE_OP_nn_hhll_X:
+            return xref_table_push(table, xref_operand(map, data[2] | (data[3] << 8)), source, XrefRead);
+        case PCE_OP_ZZ:
+        case PCE_OP_ZZ_X:
+        case PCE_OP_ZZ_Y:
+            return xref_table_push(table, xref_operand(map, 0x2000 + data[1]), source, xref_access(opcode));
+        case PCE_OP__ZZ__:
+        case PCE_OP__ZZ_X__:
+        case PCE_OP__ZZ__Y_:
+            return xref_table_push(table, xref_operand(map, 0x2000 + data[1]), source, XrefRead);
+        case PCE_OP_ZZ_hhll:
+            return xref_table_push(table, xref_operand(map, 0x2000 + data[1]), source, XrefRead)
+                && xref_table_push(table, xref_operand(map, data[2] | (data[3] << 8)), source, XrefRead);
+        case PCE_OP_hhll:
+        case PCE_OP_hhll_X:
+        case PCE_OP_hhll_Y:
+            return xref_table_push(table, xref_operand(map, data[1] | (data[2] << 8)), source, xref_access(opcode));
+        case PCE_OP__hhll__:
+        case PCE_OP__hhll_X__:
+            return xref_table_push(table, xref_operand(map, data[1] | (data[2] << 8)), source, XrefRead);
+        case PCE_OP_shsl_dhdl_hhll:
+            return xref_table_push(table, xref_operand(map, data[1] | (data[2] << 8)), source, XrefRead)
+                && xref_table_push(table, xref_operand(map, data[3] | (data[4] << 8)), source, XrefWrite);
+        default:
+            return 1;
+    }
+}
+
+
+
+/**
+ * Process code section instruction.
+ * @param [out] out Output emitter.
+ * @param [in] insn Decoded instruction.
+ * @param [in] map Memory map.
  * @param [in] repository Label repository.
+ * @param [in out] labels Label definitions to annotate with their reference count (optional).
  * @return 1 if rts, rti or brk instruction was decoded, 0 otherwise.
  */
-int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, label_repository_t *repository) {
-	int i, delta;
-	uint8_t inst, data[6], is_jump;
+int decode(emitter_t *out, const insn_t *insn, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels) {
+	int i;
+	uint8_t inst, bytes[8], *data = bytes + 1, is_jump;
 	char eor, *name;
 	uint8_t page;
 	uint32_t offset;
-	uint16_t next_logical;
 
     const opcode_t *opcode;
 
 	eor = 0;
 
-	memset(data, 0, 6);
-	page = memmap_page(map, *logical); 
+	memset(bytes, 0, 8);
+	memcpy(bytes, insn->data, insn->size);
+	page = insn->page;
 
-	/* Opcode */
-	inst = memmap_read(map, *logical);
-    opcode = opcode_get(inst);
-    
-	next_logical = *logical + opcode->size;
+	/* Opcode and data */
+	inst = bytes[0];
+	opcode = opcode_get(inst);
 
 	/* Is there a label ? */
-	if (label_repository_find(repository, *logical, page, &name)) {
+	if (label_repository_find(repository, insn->logical, page, &name)) {
 		/* Print label*/
-		fprintf(out, "%s:\n", name);
+		label_emit(out, name, insn->logical, page, labels);
+		emitter_char(out, '\n');
 	}
 
 	/* Front spacing */
-	fwrite(spacing, 1, 10, out);
+	emitter_write(out, spacing, 10);
 
 	/* Print opcode sting */
-	fwrite(opcode->name, 1, 4, out);
+	emitter_write(out, opcode->name, 4);
 
 	/* Add spacing */
-	fwrite(spacing, 1, 4, out);
+	emitter_write(out, spacing, 4);
 
 	/* End Of Routine (eor) is set to 1 if the instruction is RTI, RTS or BRK */
 	eor = ((inst == 0x40) || (inst == 0x60) || (inst == 0x00));
 	
-	/* Data */
-	if (opcode->size > 1) {
-		for (i = 0; i < (opcode->size - 1); i++) {
-			data[i] = memmap_read(map, *logical + i + 1);
-		}
-	}
-
-	*logical = next_logical;
-
 	/* Swap LSB and MSB for words */
 	if (opcode->size > 2) {
 		uint8_t swap;
@@ -307,24 +707,9 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 
 	/* Handle special cases (jumps, tam/tma and unsupported opcodes ) */
 	is_jump = 0;
-	if (opcode_is_local_jump(inst)) {
-		is_jump = 1;
-
-		i = (((inst)&0x0F) == 0x0F) ? 1 : 0;
-
-		/* Detect negative number */
-		if (data[i] & 128)
-			delta = -((data[i] - 1) ^ 0xff);
-		else
-			delta = data[i];
-
-		offset = *logical + delta;
-		data[i] = offset >> 8;
-		data[i + 1] = offset & 0xff;
-	} else if (opcode_is_far_jump(inst)) {
+	if (opcode_is_local_jump(inst) || opcode_is_far_jump(inst)) {
 		is_jump = 1;
-		/* Build offset */
-		offset = (data[0] << 8) | data[1];
+		offset = insn->target;
 	} else {
 		offset = 0;
 		/* Unknown instructions are output as raw data
@@ -336,21 +721,24 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 	}
 
 	if (opcode->type == 1) {
-		fputc('A', out);
+		emitter_char(out, 'A');
 	} else if (is_jump) {
 		/* BBR* and BBS* */
 		if ((inst & 0x0F) == 0x0F) {
 			uint16_t zp_offset = 0x2000 + data[0];                                              // [todo] RAM may not be in mpr1 ...
 			page = memmap_page(map, zp_offset);
 			if (label_repository_find(repository, zp_offset, page, &name)) {
-				fprintf(out, "<%s, ", name);
+				emitter_char(out, '<');
+				emitter_string(out, name);
+				emitter_write(out, ", ", 2);
 			} else {
-				fprintf(out, "<$%02x, ", data[0]);
+				emitter_write(out, "<$", 2);
+				emitter_hex8(out, data[0]);
+				emitter_write(out, ", ", 2);
 			}
 		}
-		page = memmap_page(map, offset);
-		label_repository_find(repository, offset, page, &name);
-		fwrite(name, 1, strlen(name), out);
+		label_repository_find(repository, offset, insn->target_page, &name);
+		emitter_string(out, name);
 	} else {
 		int has_label = 0;
 		if ((inst == 0x43) || (inst == 0x53)) {
@@ -374,7 +762,11 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "#$%02x, <%s%s", data[0], name, extra);
+					emitter_write(out, "#$", 2);
+					emitter_hex8(out, data[0]);
+					emitter_write(out, ", <", 3);
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 			case PCE_OP_nn_hhll_X:                              /* #$aa, $hhll, X */
@@ -384,7 +776,11 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "#$%02x, %s%s", data[0], name, extra);
+					emitter_write(out, "#$", 2);
+					emitter_hex8(out, data[0]);
+					emitter_write(out, ", ", 2);
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 
@@ -399,7 +795,9 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "<%s%s", name, extra);
+					emitter_char(out, '<');
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 
@@ -417,7 +815,9 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "[%s%s", name, extra);
+					emitter_char(out, '[');
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 
@@ -431,7 +831,9 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "[%s%s", name, extra);
+					emitter_char(out, '[');
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 
@@ -446,7 +848,8 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "%s%s", name, extra);
+					emitter_string(out, name);
+					emitter_string(out, extra);
 				}
 				break;
 
@@ -455,17 +858,22 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "<%s, ", name);
+					emitter_char(out, '<');
+					emitter_string(out, name);
+					emitter_write(out, ", ", 2);
 				} else {
-					fprintf(out, "<%02x, ", data[0]);
+					emitter_char(out, '<');
+					emitter_hex8(out, data[0]);
+					emitter_write(out, ", ", 2);
 				}
 				offset = (data[1] << 8) | data[2];
 				page = memmap_page(map, offset);
 				has_label = label_repository_find(repository, offset, page, &name);
 				if (has_label) {
-					fprintf(out, "%s", name);
+					emitter_string(out, name);
 				} else {
-					fprintf(out, "$%04x", offset);
+					emitter_char(out, '$');
+					emitter_hex16(out, offset);
 				}
 				has_label = 1;
 				break;
@@ -477,13 +885,17 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 					page = memmap_page(map, offset);
 					has_label = label_repository_find(repository, offset, page, &name);
 					if (has_label) {
-						fprintf(out, "%s, ", name);
+						emitter_string(out, name);
 					} else {
-						fprintf(out, "$%04x, ", offset);
+						emitter_char(out, '$');
+						emitter_hex16(out, offset);
 					}
+					emitter_write(out, ", ", 2);
 				}
 				/* Size */
-				fprintf(out, "$%02x%02x", data[4], data[5]);
+				emitter_char(out, '$');
+				emitter_hex8(out, data[4]);
+				emitter_hex8(out, data[5]);
 				has_label = 1;
 				break;
 
@@ -496,13 +908,13 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
 			    const char *format;
 			    i = 0;
 				while(format = opcode_format(opcode, i)) {
-					fprintf(out, format, data[i]);
+					emitter_format(out, format, data[i]);
 					i++;
 				}
 			}
 		}
 	}
-	fputc('\n', out);
+	emitter_char(out, '\n');
 	return eor;
 }
 
@@ -512,11 +924,15 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
  * @param [in] index Index of the current section.
  * @param [in] count Number of sections.
  * @param [in] map Memory map.
+ * @param [out] list Instructions decoded from the section start until the first jump taken.
+ *                   They can be reused by insn_list_build.
  * @return Section size. 
  */
-int32_t compute_size(section_t *sections, int index, int count, memmap_t *map) {
+int32_t compute_size(section_t *sections, int index, int count, memmap_t *map, insn_list_t *list) {
     uint8_t i;
-    uint8_t data[7];
+    insn_t insn;
+    uint8_t *data = insn.data;
+    int contiguous = 1;
     section_t *current = &sections[index];
     uint32_t start = current->logical;
     uint32_t logical = start;
@@ -541,11 +957,11 @@ int32_t compute_size(section_t *sections, int index, int count, memmap_t *map) {
             break;
         }
         uint8_t page = memmap_page(map, logical);
-    	data[0] = memmap_read(map, logical);
-        const opcode_t *opcode = opcode_get(data[0]);
-        for (i = 1; i < opcode->size; i++) {
-    		data[i] = memmap_read(map, logical + i);
-    	}
+        const opcode_t *opcode = insn_decode(&insn, map, logical);
+        if(contiguous && !insn_list_push(list, &insn)) {
+            contiguous = 0;
+            insn_list_reset(list);
+        }
         logical += opcode->size;
         if(opcode_is_far_jump(data[0])) {
             uint32_t jump = data[1] | (data[2] << 8);
@@ -557,6 +973,7 @@ int32_t compute_size(section_t *sections, int index, int count, memmap_t *map) {
                     }
                     else {
                         logical = jump; 
+                        contiguous = 0;
                     }
                 }
             }
@@ -578,6 +995,7 @@ int32_t compute_size(section_t *sections, int index, int count, memmap_t *map) {
             }
             else if(jump > logical) {
                 logical = jump;
+                contiguous = 0;
             }
         }
         else if((data[0] == 0x40) || (data[0] == 0x60) || (data[0] == 0x00)) { // rts, rti or brk
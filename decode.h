@@ -22,36 +22,109 @@
 #include "label.h"
 #include "section.h"
 #include "memorymap.h"
+#include "emitter.h"
+#include "opcodes.h"
+#include "xref.h"
 
 /**
- * Finds any jump address from the current section.
+ * Decoded instruction.
+ */
+typedef struct {
+    uint16_t logical;       /**< Logical address. **/
+    uint8_t page;           /**< Page mapped at the logical address. **/
+    uint8_t size;           /**< Instruction size (opcode and operands). **/
+    uint8_t data[7];        /**< Opcode followed by operands. **/
+    uint8_t target_page;    /**< Jump target page. **/
+    uint16_t target;        /**< Jump target logical address. **/
+} insn_t;
+
+/**
+ * Instructions of a code section.
+ */
+typedef struct {
+    insn_t *insn;           /**< Instructions in address order. **/
+    size_t count;           /**< Number of instructions. **/
+    size_t capacity;        /**< Number of allocated instructions. **/
+} insn_list_t;
+
+/**
+ * Decodes a single instruction.
+ * @param [out] insn Decoded instruction.
+ * @param [in] map Memory map.
+ * @param [in] logical Logical address.
+ * @return Opcode description.
+ */
+const opcode_t* insn_decode(insn_t *insn, memmap_t *map, uint16_t logical);
+
+/**
+ * Initializes instruction list.
+ * @param [out] list Instruction list.
+ */
+void insn_list_init(insn_list_t *list);
+
+/**
+ * Removes all instructions from the list. The storage is kept for the next section.
+ * @param [in out] list Instruction list.
+ */
+void insn_list_reset(insn_list_t *list);
+
+/**
+ * Releases instruction list storage.
+ * @param [in out] list Instruction list.
+ */
+void insn_list_destroy(insn_list_t *list);
+
+/**
+ * Decodes the instructions of a code section.
+ * Instructions already in the list (see compute_size) are kept and decoding resumes after the last one.
+ * @param [in out] list Instruction list.
  * @param [in] section Current section.
  * @param [in] map Memory map.
+ * @return 1 upon success, 0 otherwise.
+ */
+int insn_list_build(insn_list_t *list, section_t *section, memmap_t *map);
+
+/**
+ * Finds any jump address from the current section.
+ * @param [in] section Current section.
+ * @param [in] list Section instructions.
  * @param [in out] repository Label repository.
  * @return 1 upon success, 0 otherwise.
  */
-int label_extract(section_t *section, memmap_t *map, label_repository_t *repository);
+int label_extract(section_t *section, const insn_list_t *list, label_repository_t *repository);
 
 /**
  * Process data section. The result will be output has a binary file or an asm file containing hex values or strings.
- * @param [out] out File output.
+ * @param [out] out Output emitter.
  * @param [in] section Current section.
  * @param [in] map Memory map.
  * @param [in] repository Label repository.
+ * @param [in out] labels Label definitions to annotate with their reference count (optional).
  * @return 1 upon success, 0 otherwise.
  */
-int data_extract(FILE *out, section_t *section, memmap_t *map, label_repository_t *repository);
+int data_extract(emitter_t *out, section_t *section, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels);
 
 /**
- * Process code section.
- * @param [out] out File output.
- * @param [in out] logical Current logical address.
- * @param [in] section Current section.
+ * Process code section instruction.
+ * @param [out] out Output emitter.
+ * @param [in] insn Decoded instruction.
  * @param [in] map Memory map.
  * @param [in] repository Label repository.
+ * @param [in out] labels Label definitions to annotate with their reference count (optional).
  * @return 1 if rts, rti or brk instruction was decoded, 0 otherwise.
  */
-int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, label_repository_t *repository);
+int decode(emitter_t *out, const insn_t *insn, memmap_t *map, label_repository_t *repository, xref_label_list_t *labels);
+
+/**
+ * Appends the memory references of an instruction to the cross reference table.
+ * Zero page operands are mapped to $2000-$20ff. Pages are resolved with the current memory page registers,
+ * except for jump targets whose page was resolved when the instruction was decoded.
+ * @param [in out] table Cross reference table.
+ * @param [in] insn Decoded instruction.
+ * @param [in] map Memory map.
+ * @return 1 upon success, 0 otherwise.
+ */
+int insn_xref(xref_table_t *table, const insn_t *insn, memmap_t *map);
 
 /**
  * Computes section size.
@@ -59,8 +132,10 @@ int decode(FILE *out, uint16_t *logical, section_t *section, memmap_t *map, labe
  * @param [in] index Index of the current section.
  * @param [in] count Number of sections.
  * @param [in] map Memory map.
+ * @param [out] list Instructions decoded from the section start until the first jump taken.
+ *                   They can be reused by insn_list_build.
  * @return Section size. 
  */
-int32_t compute_size(section_t *sections, int index, int count, memmap_t *map);
+int32_t compute_size(section_t *sections, int index, int count, memmap_t *map, insn_list_t *list);
 
 #endif // ETRIPATOR_DECODE_H
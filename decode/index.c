@@ -0,0 +1,63 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "index.h"
+#include "../memory.h"
+
+/* Initializes instruction index. */
+void insn_index_init(insn_index_t *index) {
+    memset(index, 0, sizeof(insn_index_t));
+}
+
+/* Releases instruction index resources. */
+void insn_index_destroy(insn_index_t *index) {
+    free(index->index);
+    memset(index, 0, sizeof(insn_index_t));
+}
+
+/* Maps section bytes to instructions. */
+int insn_index_build(insn_index_t *index, const section_t *section, const insn_list_t *list) {
+    size_t i;
+    index->logical = section->logical;
+    index->size = 0;
+    if(section->size <= 0) {
+        return 1;
+    }
+    if(!mem_reserve((void**)&index->index, &index->capacity, section->size, sizeof(int32_t))) {
+        return 0;
+    }
+    index->size = section->size;
+    for(i=0; i<(size_t)index->size; i++) {
+        index->index[i] = -1;
+    }
+    for(i=0; i<list->count; i++) {
+        uint16_t offset = list->insn[i].logical - index->logical;
+        if(offset < (uint32_t)index->size) {
+            index->index[offset] = (int32_t)i;
+        }
+    }
+    return 1;
+}
+
+/* Returns the index of the instruction starting at the specified address, or -1. */
+int32_t insn_index_find(const insn_index_t *index, uint16_t logical) {
+    uint16_t offset = logical - index->logical;
+    if(offset >= (uint32_t)index->size) {
+        return -1;
+    }
+    return index->index[offset];
+}
@@ -0,0 +1,60 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_DECODE_INDEX_H
+#define ETRIPATOR_DECODE_INDEX_H
+
+#include "../decode.h"
+
+/**
+ * Maps the bytes of a code section to the instructions starting at them.
+ */
+typedef struct {
+    int32_t *index;     /**< Instruction index of each section byte, or -1. **/
+    size_t capacity;    /**< Number of entries the index can hold. **/
+    uint16_t logical;   /**< Section logical address. **/
+    int32_t size;       /**< Section size. **/
+} insn_index_t;
+
+/**
+ * Initialize instruction index.
+ * \param [out] index Instruction index.
+ */
+void insn_index_init(insn_index_t *index);
+/**
+ * Release instruction index resources.
+ * \param [in] index Instruction index.
+ */
+void insn_index_destroy(insn_index_t *index);
+/**
+ * Map section bytes to instructions.
+ * The index memory is reused between calls.
+ * \param [in out] index   Instruction index.
+ * \param [in]     section Code section.
+ * \param [in]     list    Decoded section instructions.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int insn_index_build(insn_index_t *index, const section_t *section, const insn_list_t *list);
+/**
+ * Retrieve the instruction starting at the specified address.
+ * \param [in] index   Instruction index.
+ * \param [in] logical Logical address.
+ * \return Instruction index, or -1 if no instruction starts at this address.
+ */
+int32_t insn_index_find(const insn_index_t *index, uint16_t logical);
+
+#endif // ETRIPATOR_DECODE_INDEX_H
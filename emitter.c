@@ -0,0 +1,322 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "emitter.h"
+#include "message.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EMITTER_AVX2
+#define EMITTER_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define EMITTER_SSE2
+#endif
+
+const char emitter_hex_digits[512] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/* Initializes emitter. */
+int emitter_init(emitter_t *emitter) {
+    emitter->out = NULL;
+    emitter->size = 0;
+    emitter->error = 0;
+    emitter->buffer = (char*)malloc(EMITTER_CAPACITY);
+    if(NULL == emitter->buffer) {
+        ERROR_MSG("Failed to allocate output buffer: %s", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+/* Releases emitter buffer. */
+void emitter_destroy(emitter_t *emitter) {
+    free(emitter->buffer);
+    emitter->buffer = NULL;
+    emitter->out = NULL;
+    emitter->size = 0;
+}
+
+/* Empties the buffer and sets the output file. */
+void emitter_reset(emitter_t *emitter, FILE *out) {
+    emitter->out = out;
+    emitter->size = 0;
+    emitter->error = 0;
+}
+
+/* Writes buffer content to the output file. */
+int emitter_flush(emitter_t *emitter) {
+    if(emitter->size) {
+        if(fwrite(emitter->buffer, 1, emitter->size, emitter->out) != emitter->size) {
+            if(!emitter->error) {
+                ERROR_MSG("Failed to write output: %s", strerror(errno));
+            }
+            emitter->error = 1;
+        }
+        emitter->size = 0;
+    }
+    return !emitter->error;
+}
+
+/* Creates a file and fills it through a temporary emitter. */
+int emitter_save(const char *filename, emitter_writer_t writer, const void *data) {
+    emitter_t out;
+    FILE *stream;
+    int ret;
+
+    memset(&out, 0, sizeof(emitter_t));
+    if(!emitter_init(&out)) {
+        return 0;
+    }
+    stream = fopen(filename, "wb");
+    if(stream == NULL) {
+        ERROR_MSG("Failed to open %s: %s", filename, strerror(errno));
+        emitter_destroy(&out);
+        return 0;
+    }
+    emitter_reset(&out, stream);
+    writer(&out, data);
+    ret = emitter_flush(&out);
+    if(fclose(stream)) {
+        ERROR_MSG("Failed to write %s: %s", filename, strerror(errno));
+        ret = 0;
+    }
+    emitter_destroy(&out);
+    return ret;
+}
+
+/* Returns the output file offset of the end of the buffer. */
+uint64_t emitter_tell(emitter_t *emitter) {
+    long pos = ftell(emitter->out);
+    if(pos < 0) {
+        if(!emitter->error) {
+            ERROR_MSG("Failed to retrieve output offset: %s", strerror(errno));
+        }
+        emitter->error = 1;
+        return 0;
+    }
+    return (uint64_t)pos + emitter->size;
+}
+
+/* Appends raw bytes. */
+void emitter_write(emitter_t *emitter, const void *data, size_t len) {
+    if((emitter->size + len) > EMITTER_CAPACITY) {
+        emitter_flush(emitter);
+        if(len >= EMITTER_CAPACITY) {
+            if(fwrite(data, 1, len, emitter->out) != len) {
+                if(!emitter->error) {
+                    ERROR_MSG("Failed to write output: %s", strerror(errno));
+                }
+                emitter->error = 1;
+            }
+            return;
+        }
+    }
+    memcpy(emitter->buffer + emitter->size, data, len);
+    emitter->size += len;
+}
+
+/* Appends formatted text. */
+void emitter_printf(emitter_t *emitter, const char *format, ...) {
+    va_list args;
+    int len;
+    size_t avail = EMITTER_CAPACITY - emitter->size;
+
+    va_start(args, format);
+    len = vsnprintf(emitter->buffer + emitter->size, avail, format, args);
+    va_end(args);
+    if(len < 0) {
+        return;
+    }
+    if((size_t)len >= avail) {
+        /* Not enough space left. */
+        emitter_flush(emitter);
+        if((size_t)len >= EMITTER_CAPACITY) {
+            va_start(args, format);
+            vfprintf(emitter->out, format, args);
+            va_end(args);
+            return;
+        }
+        va_start(args, format);
+        len = vsnprintf(emitter->buffer, EMITTER_CAPACITY, format, args);
+        va_end(args);
+    }
+    emitter->size += len;
+}
+
+#if defined(EMITTER_SSE2)
+/* Index of the least significant bit set. */
+static inline int emitter_bit_scan(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+#if defined(EMITTER_AVX2)
+/* Converts 32 bytes to "$xx," strings. */
+static void emitter_hex_block(char *dst, const uint8_t *src) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i alpha = _mm256_set1_epi8('a' - '0' - 10);
+    const __m256i dollar = _mm256_set1_epi8('$');
+    const __m256i comma = _mm256_set1_epi8(',');
+
+    __m256i v = _mm256_loadu_si256((const __m256i*)src);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+    __m256i lo = _mm256_and_si256(v, mask);
+    hi = _mm256_add_epi8(_mm256_add_epi8(hi, zero), _mm256_and_si256(_mm256_cmpgt_epi8(hi, nine), alpha));
+    lo = _mm256_add_epi8(_mm256_add_epi8(lo, zero), _mm256_and_si256(_mm256_cmpgt_epi8(lo, nine), alpha));
+
+    /* Unpacking works on 128 bits lanes. Each lane holds 4 strings. */
+    __m256i a0 = _mm256_unpacklo_epi8(dollar, hi);
+    __m256i a1 = _mm256_unpackhi_epi8(dollar, hi);
+    __m256i b0 = _mm256_unpacklo_epi8(lo, comma);
+    __m256i b1 = _mm256_unpackhi_epi8(lo, comma);
+    __m256i s0 = _mm256_unpacklo_epi16(a0, b0);     /* 0-3   16-19 */
+    __m256i s1 = _mm256_unpackhi_epi16(a0, b0);     /* 4-7   20-23 */
+    __m256i s2 = _mm256_unpacklo_epi16(a1, b1);     /* 8-11  24-27 */
+    __m256i s3 = _mm256_unpackhi_epi16(a1, b1);     /* 12-15 28-31 */
+
+    _mm256_storeu_si256((__m256i*)(dst     ), _mm256_permute2x128_si256(s0, s1, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(s2, s3, 0x20));
+    _mm256_storeu_si256((__m256i*)(dst + 64), _mm256_permute2x128_si256(s0, s1, 0x31));
+    _mm256_storeu_si256((__m256i*)(dst + 96), _mm256_permute2x128_si256(s2, s3, 0x31));
+}
+#define EMITTER_HEX_BLOCK 32
+#elif defined(EMITTER_SSE2)
+/* Converts 16 bytes to "$xx," strings. */
+static void emitter_hex_block(char *dst, const uint8_t *src) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i alpha = _mm_set1_epi8('a' - '0' - 10);
+    const __m128i dollar = _mm_set1_epi8('$');
+    const __m128i comma = _mm_set1_epi8(',');
+
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    __m128i lo = _mm_and_si128(v, mask);
+    hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+    lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+
+    /* '$' and the high digit, the low digit and ',' */
+    __m128i a0 = _mm_unpacklo_epi8(dollar, hi);
+    __m128i a1 = _mm_unpackhi_epi8(dollar, hi);
+    __m128i b0 = _mm_unpacklo_epi8(lo, comma);
+    __m128i b1 = _mm_unpackhi_epi8(lo, comma);
+
+    _mm_storeu_si128((__m128i*)(dst     ), _mm_unpacklo_epi16(a0, b0));
+    _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(a0, b0));
+    _mm_storeu_si128((__m128i*)(dst + 32), _mm_unpacklo_epi16(a1, b1));
+    _mm_storeu_si128((__m128i*)(dst + 48), _mm_unpackhi_epi16(a1, b1));
+}
+#define EMITTER_HEX_BLOCK 16
+#endif
+
+/* Appends a comma separated list of hexadecimal values. */
+void emitter_hex_list(emitter_t *emitter, const uint8_t *src, size_t count, int element_size) {
+    size_t i;
+    char *dst;
+    if(count == 0) {
+        return;
+    }
+    if(element_size > 1) {
+        dst = emitter_reserve(emitter, count * 6);
+        for(i=0; i<count; i++, src+=2, dst+=6) {
+            dst[0] = '$';
+            dst[1] = emitter_hex_digits[2*src[1]];
+            dst[2] = emitter_hex_digits[2*src[1] + 1];
+            dst[3] = emitter_hex_digits[2*src[0]];
+            dst[4] = emitter_hex_digits[2*src[0] + 1];
+            dst[5] = ',';
+        }
+        emitter->size += count * 6 - 1;
+        return;
+    }
+    dst = emitter_reserve(emitter, count * 4);
+    i = 0;
+#if defined(EMITTER_HEX_BLOCK)
+    for(; (i+EMITTER_HEX_BLOCK) <= count; i+=EMITTER_HEX_BLOCK, src+=EMITTER_HEX_BLOCK, dst+=4*EMITTER_HEX_BLOCK) {
+        emitter_hex_block(dst, src);
+    }
+#endif
+    for(; i<count; i++, src++, dst+=4) {
+        dst[0] = '$';
+        dst[1] = emitter_hex_digits[2*src[0]];
+        dst[2] = emitter_hex_digits[2*src[0] + 1];
+        dst[3] = ',';
+    }
+    /* Remove trailing comma. */
+    emitter->size += count * 4 - 1;
+}
+
+/* Counts the leading printable ASCII characters. */
+size_t emitter_printable_length(const uint8_t *src, size_t len) {
+    size_t i = 0;
+#if defined(EMITTER_SSE2)
+    /* Bytes above 0x7f are negative when compared as signed values. */
+    const __m128i lower = _mm_set1_epi8(0x1f);
+    const __m128i upper = _mm_set1_epi8(0x7f);
+    for(; (i+16) <= len; i+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, lower), _mm_cmplt_epi8(v, upper));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(printable) ^ 0xffff;
+        if(mask) {
+            return i + emitter_bit_scan(mask);
+        }
+    }
+#endif
+    for(; (i<len) && (src[i] >= 0x20) && (src[i] < 0x7f); i++) {
+    }
+    return i;
+}
+
+/* Appends printable characters and escapes double quotes. */
+void emitter_escaped(emitter_t *emitter, const uint8_t *src, size_t len) {
+    while(len) {
+        const uint8_t *quote = (const uint8_t*)memchr(src, '"', len);
+        size_t n = quote ? (size_t)(quote - src) : len;
+        emitter_write(emitter, src, n);
+        if(quote == NULL) {
+            break;
+        }
+        emitter_write(emitter, "\\\"", 2);
+        src += n + 1;
+        len -= n + 1;
+    }
+}
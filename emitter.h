@@ -0,0 +1,193 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_EMITTER_H
+#define ETRIPATOR_EMITTER_H
+
+#include "config.h"
+
+#define EMITTER_CAPACITY 65536
+#define EMITTER_HEX_MAX 1024
+
+/**
+ * Buffered text output.
+ * Text is accumulated in memory and written to the output file with a single write per flush.
+ * The buffer is allocated once and reused for every section.
+ */
+typedef struct {
+    FILE *out;         /**< Output file. **/
+    char *buffer;      /**< Text buffer. **/
+    size_t size;       /**< Number of bytes in the buffer. **/
+    int error;         /**< Set if a write failed. **/
+} emitter_t;
+
+/**
+ * Hexadecimal digit pairs for every byte value.
+ */
+extern const char emitter_hex_digits[512];
+
+/**
+ * Initializes emitter.
+ * \param emitter Emitter.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int emitter_init(emitter_t *emitter);
+/**
+ * Releases emitter buffer. Pending text is discarded.
+ * \param emitter Emitter.
+ */
+void emitter_destroy(emitter_t *emitter);
+/**
+ * Empties the buffer and sets the output file.
+ * \param emitter Emitter.
+ * \param out Output file.
+ */
+void emitter_reset(emitter_t *emitter, FILE *out);
+/**
+ * Writes buffer content to the output file.
+ * \param emitter Emitter.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int emitter_flush(emitter_t *emitter);
+/**
+ * Writes the whole content of an output file.
+ * \param emitter Emitter.
+ * \param data User data.
+ */
+typedef void (*emitter_writer_t)(emitter_t *emitter, const void *data);
+/**
+ * Creates a file and fills it through a temporary emitter.
+ * \param filename Output filename.
+ * \param writer Function writing the file content.
+ * \param data User data passed to the writer.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int emitter_save(const char *filename, emitter_writer_t writer, const void *data);
+/**
+ * Returns the output file offset of the end of the buffer, i.e. where the next byte will be written.
+ * \param emitter Emitter.
+ * \return Output file offset.
+ */
+uint64_t emitter_tell(emitter_t *emitter);
+/**
+ * Appends raw bytes. Blocks larger than the buffer are written directly to the output file.
+ * \param emitter Emitter.
+ * \param data Bytes.
+ * \param len Number of bytes.
+ */
+void emitter_write(emitter_t *emitter, const void *data, size_t len);
+/**
+ * Appends formatted text. This is meant for uncommon cases as it goes through vsnprintf.
+ * \param emitter Emitter.
+ * \param format Format string.
+ */
+void emitter_printf(emitter_t *emitter, const char *format, ...);
+/**
+ * Appends a comma separated list of hexadecimal values ($xx or $hhll).
+ * Bytes are converted 16 (SSE2) or 32 (AVX2) at a time when the target supports it.
+ * \param emitter Emitter.
+ * \param src Elements. Words are stored in little endian.
+ * \param count Number of elements (at most EMITTER_HEX_MAX).
+ * \param element_size Element size in bytes (1 or 2).
+ */
+void emitter_hex_list(emitter_t *emitter, const uint8_t *src, size_t count, int element_size);
+
+/**
+ * Counts the leading printable ASCII characters (0x20 to 0x7e) of a byte array.
+ * Bytes are tested 16 at a time when the target supports SSE2.
+ * \param src Bytes.
+ * \param len Number of bytes.
+ * \return Number of printable characters before the first non printable one.
+ */
+size_t emitter_printable_length(const uint8_t *src, size_t len);
+/**
+ * Appends printable characters. Double quotes are escaped.
+ * \param emitter Emitter.
+ * \param src Characters.
+ * \param len Number of characters.
+ */
+void emitter_escaped(emitter_t *emitter, const uint8_t *src, size_t len);
+
+/**
+ * Reserves space in the buffer.
+ * \param emitter Emitter.
+ * \param len Number of bytes to be written (must be less than EMITTER_CAPACITY).
+ * \return Pointer to the reserved space.
+ */
+static inline char* emitter_reserve(emitter_t *emitter, size_t len) {
+    if((emitter->size + len) > EMITTER_CAPACITY) {
+        emitter_flush(emitter);
+    }
+    return emitter->buffer + emitter->size;
+}
+/**
+ * Appends a single character.
+ * \param emitter Emitter.
+ * \param c Character.
+ */
+static inline void emitter_char(emitter_t *emitter, char c) {
+    *emitter_reserve(emitter, 1) = c;
+    emitter->size++;
+}
+/**
+ * Appends a nul terminated string.
+ * \param emitter Emitter.
+ * \param str String.
+ */
+static inline void emitter_string(emitter_t *emitter, const char *str) {
+    emitter_write(emitter, str, strlen(str));
+}
+/**
+ * Appends a byte as 2 lowercase hexadecimal digits.
+ * \param emitter Emitter.
+ * \param value Byte value.
+ */
+static inline void emitter_hex8(emitter_t *emitter, uint8_t value) {
+    char *dst = emitter_reserve(emitter, 2);
+    dst[0] = emitter_hex_digits[2*value];
+    dst[1] = emitter_hex_digits[2*value + 1];
+    emitter->size += 2;
+}
+/**
+ * Appends a word as 4 lowercase hexadecimal digits.
+ * \param emitter Emitter.
+ * \param value Word value.
+ */
+static inline void emitter_hex16(emitter_t *emitter, uint16_t value) {
+    emitter_hex8(emitter, (uint8_t)(value >> 8));
+    emitter_hex8(emitter, (uint8_t)value);
+}
+/**
+ * Appends an opcode operand format (see opcode_format).
+ * The "%02x" conversion is replaced by the hexadecimal value of the operand byte.
+ * \param emitter Emitter.
+ * \param format Operand format.
+ * \param value Operand byte.
+ */
+static inline void emitter_format(emitter_t *emitter, const char *format, uint8_t value) {
+    for(; *format; format++) {
+        if(*format == '%') {
+            emitter_hex8(emitter, value);
+            format += 3;
+        }
+        else {
+            emitter_char(emitter, *format);
+        }
+    }
+}
+
+#endif // ETRIPATOR_EMITTER_H
@@ -0,0 +1,188 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "filemap.h"
+#include "message.h"
+
+#if !defined(_MSC_VER)
+#include <sys/mman.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+/**
+ * Initialize an empty file mapping.
+ * \param [out] map Memory mapped file.
+ */
+void filemap_init(filemap_t *map) {
+    map->data = NULL;
+    map->len = 0;
+#if defined(_MSC_VER)
+    map->file = INVALID_HANDLE_VALUE;
+    map->mapping = NULL;
+#else
+    map->fd = -1;
+#endif
+}
+
+/**
+ * Map file into memory.
+ * \param [out] map      Memory mapped file.
+ * \param [in]  filename Filename.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int filemap_open(filemap_t *map, const char *filename) {
+#if defined(_MSC_VER)
+    LARGE_INTEGER size;
+    map->data = NULL;
+    map->len = 0;
+    map->mapping = NULL;
+    map->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(map->file == INVALID_HANDLE_VALUE) {
+        ERROR_MSG("Unable to open %s : error %lu", filename, GetLastError());
+        return 0;
+    }
+    if(!GetFileSizeEx(map->file, &size)) {
+        ERROR_MSG("Unable to retrieve %s size : error %lu", filename, GetLastError());
+        filemap_close(map);
+        return 0;
+    }
+    map->len = (size_t)size.QuadPart;
+    if(map->len) {
+        map->mapping = CreateFileMappingA(map->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if(map->mapping != NULL) {
+            map->data = (uint8_t*)MapViewOfFile(map->mapping, FILE_MAP_COPY, 0, 0, 0);
+        }
+        if(map->data == NULL) {
+            ERROR_MSG("Unable to map %s : error %lu", filename, GetLastError());
+            filemap_close(map);
+            return 0;
+        }
+    }
+    return 1;
+#else
+    struct stat st;
+    map->data = NULL;
+    map->len = 0;
+    map->fd = open(filename, O_RDONLY);
+    if(map->fd < 0) {
+        ERROR_MSG("Unable to open %s : %s", filename, strerror(errno));
+        return 0;
+    }
+    if(fstat(map->fd, &st)) {
+        ERROR_MSG("Unable to retrieve %s size : %s", filename, strerror(errno));
+        filemap_close(map);
+        return 0;
+    }
+    map->len = (size_t)st.st_size;
+    if(map->len) {
+        void *ptr = mmap(NULL, map->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, map->fd, 0);
+        if(ptr == MAP_FAILED) {
+            ERROR_MSG("Unable to map %s : %s", filename, strerror(errno));
+            map->len = 0;
+            filemap_close(map);
+            return 0;
+        }
+        map->data = (uint8_t*)ptr;
+    }
+    return 1;
+#endif
+}
+
+/**
+ * Copy part of a mapped file to an output file.
+ * \param [in] map    Memory mapped file.
+ * \param [in] offset File offset.
+ * \param [in] len    Number of bytes to copy.
+ * \param [in] out    Output file.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int filemap_copy(const filemap_t *map, size_t offset, size_t len, FILE *out) {
+    if((offset > map->len) || (len > (map->len - offset))) {
+        ERROR_MSG("Offset out of bound (%zx, %zx bytes)", offset, len);
+        return 0;
+    }
+#if defined(__linux__)
+    if(len) {
+        int fd = fileno(out);
+        off_t in = (off_t)offset;
+        if(fflush(out)) {
+            ERROR_MSG("Failed to write output: %s", strerror(errno));
+            return 0;
+        }
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 27)))
+        while(len) {
+            ssize_t n = copy_file_range(map->fd, &in, fd, NULL, len, 0);
+            if(n <= 0) {
+                /* Not supported by the kernel or filesystems. Try sendfile. */
+                break;
+            }
+            len -= (size_t)n;
+        }
+#endif
+        while(len) {
+            ssize_t n = sendfile(fd, map->fd, &in, len);
+            if(n <= 0) {
+                break;
+            }
+            len -= (size_t)n;
+        }
+        offset = (size_t)in;
+        /* Resynchronize stream position with the file descriptor. */
+        if(fseek(out, 0, SEEK_END)) {
+            ERROR_MSG("Failed to write output: %s", strerror(errno));
+            return 0;
+        }
+    }
+#endif
+    if(len && (fwrite(map->data + offset, 1, len, out) != len)) {
+        ERROR_MSG("Failed to write output: %s", strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Unmap file.
+ * \param [in,out] map Memory mapped file.
+ */
+void filemap_close(filemap_t *map) {
+#if defined(_MSC_VER)
+    if(map->data) {
+        UnmapViewOfFile(map->data);
+    }
+    if(map->mapping) {
+        CloseHandle(map->mapping);
+    }
+    if(map->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(map->file);
+    }
+    map->mapping = NULL;
+    map->file = INVALID_HANDLE_VALUE;
+#else
+    if(map->data) {
+        munmap(map->data, map->len);
+    }
+    if(map->fd >= 0) {
+        close(map->fd);
+    }
+    map->fd = -1;
+#endif
+    map->data = NULL;
+    map->len = 0;
+}
@@ -0,0 +1,90 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_FILEMAP_H
+#define ETRIPATOR_FILEMAP_H
+
+#include "config.h"
+
+/**
+ * Memory mapped file.
+ * The mapping is private. Writes are not propagated to the file.
+ */
+typedef struct {
+    uint8_t *data; /**< File content. **/
+    size_t   len;  /**< File size (in bytes). **/
+#if defined(_MSC_VER)
+    HANDLE file;    /**< File handle. **/
+    HANDLE mapping; /**< File mapping handle. **/
+#else
+    int fd;         /**< File descriptor. **/
+#endif
+} filemap_t;
+
+/**
+ * Initialize an empty file mapping.
+ * filemap_close can be safely called on it.
+ * \param [out] map Memory mapped file.
+ */
+void filemap_init(filemap_t *map);
+
+/**
+ * Map file into memory.
+ * \param [out] map      Memory mapped file.
+ * \param [in]  filename Filename.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int filemap_open(filemap_t *map, const char *filename);
+
+/**
+ * Tells if a memory block lies inside the file mapping.
+ * \param [in]  map    Memory mapped file.
+ * \param [in]  ptr    Memory block.
+ * \param [in]  len    Memory block size (in bytes).
+ * \param [out] offset File offset of the memory block.
+ * \return 1 if the memory block is part of the mapping, 0 otherwise.
+ */
+static inline int filemap_contains(const filemap_t *map, const uint8_t *ptr, size_t len, size_t *offset) {
+    uintptr_t start = (uintptr_t)map->data;
+    uintptr_t addr = (uintptr_t)ptr;
+    if((map->data == NULL) || (addr < start) || ((addr - start) > map->len) || (len > (map->len - (addr - start)))) {
+        return 0;
+    }
+    *offset = (size_t)(addr - start);
+    return 1;
+}
+
+/**
+ * Copy part of a mapped file to an output file.
+ * On Linux the data is transfered by the kernel (copy_file_range or sendfile).
+ * Otherwise it is written from the mapping.
+ * The output file must not be opened in append mode.
+ * \param [in] map    Memory mapped file.
+ * \param [in] offset File offset.
+ * \param [in] len    Number of bytes to copy.
+ * \param [in] out    Output file.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int filemap_copy(const filemap_t *map, size_t offset, size_t len, FILE *out);
+
+/**
+ * Unmap file.
+ * \param [in,out] map Memory mapped file.
+ */
+void filemap_close(filemap_t *map);
+
+#endif // ETRIPATOR_FILEMAP_H
@@ -0,0 +1,156 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "flow.h"
+#include "message.h"
+#include "memory.h"
+
+/* Tells if the instruction is a conditional branch. */
+static int flow_is_branch(uint8_t inst) {
+    return opcode_is_local_jump(inst) && (inst != 0x80) && (inst != 0x44);
+}
+
+/* Tells if the instruction ends a basic block. */
+static int flow_is_block_end(uint8_t inst) {
+    return flow_is_branch(inst)
+        || (inst == 0x00)    /* BRK */
+        || (inst == 0x40)    /* RTI */
+        || (inst == 0x60)    /* RTS */
+        || (inst == 0x4c)    /* JMP hhll */
+        || (inst == 0x6c)    /* JMP (hhll) */
+        || (inst == 0x7c)    /* JMP (hhll, X) */
+        || (inst == 0x80);   /* BRA */
+}
+
+/* Tells if the execution can continue with the next instruction. */
+static int flow_has_fallthrough(uint8_t inst) {
+    return (inst != 0x00) && (inst != 0x40) && (inst != 0x60) && (inst != 0x4c)
+        && (inst != 0x6c) && (inst != 0x7c) && (inst != 0x80);
+}
+
+static int flow_edge_add(flow_graph_t *graph, flow_block_t *block, uint8_t kind, uint16_t logical, uint8_t page) {
+    flow_edge_t *edge;
+    if(!mem_reserve((void**)&graph->edge, &graph->edge_capacity, graph->edge_count + 1, sizeof(flow_edge_t))) {
+        return 0;
+    }
+    edge = &graph->edge[graph->edge_count++];
+    /* Targets are resolved once all the blocks of the section are known. */
+    edge->block = FLOW_EXTERNAL;
+    edge->logical = logical;
+    edge->page = page;
+    edge->kind = kind;
+    block->edge_count++;
+    return 1;
+}
+
+/* Initializes control flow graph. */
+void flow_graph_init(flow_graph_t *graph) {
+    memset(graph, 0, sizeof(flow_graph_t));
+}
+
+/* Releases control flow graph resources. */
+void flow_graph_destroy(flow_graph_t *graph) {
+    free(graph->block);
+    free(graph->edge);
+    insn_index_destroy(&graph->index);
+    free(graph->leader);
+    free(graph->insn_block);
+    memset(graph, 0, sizeof(flow_graph_t));
+}
+
+/* Splits a code section into basic blocks. */
+int flow_graph_add(flow_graph_t *graph, const section_t *section, int index, const insn_list_t *list) {
+    size_t i, first_edge;
+    flow_block_t *block = NULL;
+
+    if((list->count == 0) || (section->size <= 0)) {
+        return 1;
+    }
+    if(!insn_index_build(&graph->index, section, list)
+    || !mem_reserve((void**)&graph->leader, &graph->leader_capacity, list->count, sizeof(uint8_t))
+    || !mem_reserve((void**)&graph->insn_block, &graph->insn_block_capacity, list->count, sizeof(uint32_t))) {
+        return 0;
+    }
+
+    /* Find block leaders. */
+    memset(graph->leader, 0, list->count);
+    graph->leader[0] = 1;
+    for(i=0; i<list->count; i++) {
+        const insn_t *insn = &list->insn[i];
+        uint8_t inst = insn->data[0];
+        if(flow_is_block_end(inst)) {
+            if((i+1) < list->count) {
+                graph->leader[i+1] = 1;
+            }
+        }
+        if((opcode_is_local_jump(inst) || opcode_is_far_jump(inst)) && (inst != 0x20) && (inst != 0x44)) {
+            int32_t j = insn_index_find(&graph->index, insn->target);
+            if(j >= 0) {
+                graph->leader[j] = 1;
+            }
+        }
+    }
+
+    /* Build blocks and edges. */
+    first_edge = graph->edge_count;
+    for(i=0; i<list->count; i++) {
+        const insn_t *insn = &list->insn[i];
+        uint8_t inst = insn->data[0];
+        int last = ((i+1) == list->count) || graph->leader[i+1];
+        if(graph->leader[i]) {
+            if(!mem_reserve((void**)&graph->block, &graph->block_capacity, graph->block_count + 1, sizeof(flow_block_t))) {
+                return 0;
+            }
+            block = &graph->block[graph->block_count++];
+            block->logical = insn->logical;
+            block->page = insn->page;
+            block->size = 0;
+            block->insn_count = 0;
+            block->edge = (uint32_t)graph->edge_count;
+            block->edge_count = 0;
+            block->section = index;
+        }
+        block->size += insn->size;
+        block->insn_count++;
+        graph->insn_block[i] = (uint32_t)(graph->block_count - 1);
+        if(!last) {
+            continue;
+        }
+        if(opcode_is_local_jump(inst) || (inst == 0x4c)) {
+            if((inst != 0x44) && !flow_edge_add(graph, block, flow_is_branch(inst) ? FlowBranch : FlowJump, insn->target, insn->target_page)) {
+                return 0;
+            }
+        }
+        if(flow_has_fallthrough(inst)) {
+            uint16_t next = insn->logical + insn->size;
+            uint8_t page = ((i+1) < list->count) ? list->insn[i+1].page : insn->page;
+            if(!flow_edge_add(graph, block, FlowFallthrough, next, page)) {
+                return 0;
+            }
+        }
+    }
+
+    /* Resolve edges to the blocks of the section. */
+    for(i=first_edge; i<graph->edge_count; i++) {
+        flow_edge_t *edge = &graph->edge[i];
+        int32_t j = insn_index_find(&graph->index, edge->logical);
+        if((j >= 0) && graph->leader[j]) {
+            edge->block = graph->insn_block[j];
+        }
+    }
+    return 1;
+}
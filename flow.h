@@ -0,0 +1,106 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_FLOW_H
+#define ETRIPATOR_FLOW_H
+
+#include "config.h"
+#include "decode.h"
+#include "decode/index.h"
+#include "section.h"
+
+/**
+ * Edge target value for targets that are not the start of a block of the same section.
+ */
+#define FLOW_EXTERNAL 0xffffffffU
+
+/**
+ * Control flow edge kind.
+ */
+typedef enum {
+    FlowFallthrough = 0,   /**< Execution continues with the next instruction. **/
+    FlowBranch,            /**< Conditional branch taken. **/
+    FlowJump,              /**< Unconditional jump (jmp, bra). **/
+    FlowEdgeKindCount
+} flow_edge_kind_t;
+
+/**
+ * Control flow edge.
+ */
+typedef struct {
+    uint32_t block;      /**< Target block index, or FLOW_EXTERNAL. **/
+    uint16_t logical;    /**< Target logical address. **/
+    uint8_t page;        /**< Target page. **/
+    uint8_t kind;        /**< Edge kind (see flow_edge_kind_t). **/
+} flow_edge_t;
+
+/**
+ * Basic block.
+ * The outgoing edges of a block are stored contiguously in the graph edge array.
+ */
+typedef struct {
+    uint16_t logical;    /**< Logical address of the first instruction. **/
+    uint8_t page;        /**< Page of the first instruction. **/
+    uint16_t size;       /**< Size in bytes. **/
+    uint32_t insn_count; /**< Number of instructions. **/
+    uint32_t edge;       /**< Index of the first outgoing edge. **/
+    uint32_t edge_count; /**< Number of outgoing edges. **/
+    int section;         /**< Section index. **/
+} flow_block_t;
+
+/**
+ * Control flow graph of the disassembled code sections.
+ */
+typedef struct {
+    flow_block_t *block;
+    size_t block_count;
+    size_t block_capacity;
+    flow_edge_t *edge;
+    size_t edge_count;
+    size_t edge_capacity;
+    insn_index_t index;     /**< Instruction index of each section byte (scratch). **/
+    uint8_t *leader;        /**< Block start flag of each instruction (scratch). **/
+    size_t leader_capacity;
+    uint32_t *insn_block;   /**< Block index of each instruction (scratch). **/
+    size_t insn_block_capacity;
+} flow_graph_t;
+
+/**
+ * Initializes control flow graph.
+ * \param [out] graph Control flow graph.
+ */
+void flow_graph_init(flow_graph_t *graph);
+
+/**
+ * Releases control flow graph resources.
+ * \param [in,out] graph Control flow graph.
+ */
+void flow_graph_destroy(flow_graph_t *graph);
+
+/**
+ * Splits a code section into basic blocks and adds them to the graph.
+ * Blocks end at jumps, branches, returns and before every jump target of the section.
+ * Subroutine calls (jsr, bsr) do not end blocks.
+ * \param [in,out] graph   Control flow graph.
+ * \param [in]     section Code section.
+ * \param [in]     index   Section index.
+ * \param [in]     list    Section instructions.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int flow_graph_add(flow_graph_t *graph, const section_t *section, int index, const insn_list_t *list);
+
+#endif // ETRIPATOR_FLOW_H
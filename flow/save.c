@@ -0,0 +1,137 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <errno.h>
+#include <string.h>
+
+#include "save.h"
+#include "../emitter.h"
+#include "../message.h"
+
+static const char *flow_edge_kind_name[FlowEdgeKindCount] = {
+    "fallthrough", "branch", "jump"
+};
+
+static const char *flow_edge_dot_style[FlowEdgeKindCount] = {
+    "dashed", "solid", "bold"
+};
+
+/* Appends a node id (page and logical address). */
+static void flow_node_id(emitter_t *out, uint8_t page, uint16_t logical) {
+    emitter_string(out, "n");
+    emitter_hex8(out, page);
+    emitter_char(out, '_');
+    emitter_hex16(out, logical);
+}
+
+/* Control flow graph output. */
+typedef struct {
+    const flow_graph_t *graph;
+    const section_t *section;
+    label_repository_t *repository;
+} flow_graph_output_t;
+
+static void flow_graph_write_dot(emitter_t *out, const void *data) {
+    const flow_graph_t *graph = ((const flow_graph_output_t*)data)->graph;
+    const section_t *section = ((const flow_graph_output_t*)data)->section;
+    label_repository_t *repository = ((const flow_graph_output_t*)data)->repository;
+    size_t i;
+    emitter_string(out, "digraph cfg {\n\tnode [shape=box, fontname=\"monospace\"];\n");
+    for(i=0; i<graph->block_count; i++) {
+        const flow_block_t *block = &graph->block[i];
+        char *name = NULL;
+        emitter_char(out, '\t');
+        flow_node_id(out, block->page, block->logical);
+        emitter_string(out, " [label=\"");
+        if(label_repository_find(repository, block->logical, block->page, &name)) {
+            emitter_string(out, name);
+            emitter_string(out, "\\n");
+        }
+        emitter_printf(out, "%02x:%04x %u byte(s), %u instruction(s)\\n%s\"];\n",
+                       block->page, block->logical, block->size, block->insn_count, section[block->section].name);
+    }
+    for(i=0; i<graph->block_count; i++) {
+        const flow_block_t *block = &graph->block[i];
+        uint32_t j;
+        for(j=0; j<block->edge_count; j++) {
+            const flow_edge_t *edge = &graph->edge[block->edge + j];
+            emitter_char(out, '\t');
+            flow_node_id(out, block->page, block->logical);
+            emitter_string(out, " -> ");
+            flow_node_id(out, edge->page, edge->logical);
+            emitter_string(out, " [style=");
+            emitter_string(out, flow_edge_dot_style[edge->kind]);
+            emitter_string(out, "];\n");
+        }
+    }
+    emitter_string(out, "}\n");
+}
+
+static void flow_graph_write_json(emitter_t *out, const void *data) {
+    const flow_graph_t *graph = ((const flow_graph_output_t*)data)->graph;
+    const section_t *section = ((const flow_graph_output_t*)data)->section;
+    label_repository_t *repository = ((const flow_graph_output_t*)data)->repository;
+    size_t i;
+    emitter_string(out, "[\n");
+    for(i=0; i<graph->block_count; i++) {
+        const flow_block_t *block = &graph->block[i];
+        char *name = NULL;
+        uint32_t j;
+        emitter_string(out, "\t{ \"id\":");
+        emitter_printf(out, "%zu", i);
+        emitter_string(out, ", \"logical\":\"");
+        emitter_hex16(out, block->logical);
+        emitter_string(out, "\", \"page\":\"");
+        emitter_hex8(out, block->page);
+        emitter_printf(out, "\", \"size\":%u, \"instructions\":%u, \"section\":\"%s\"", block->size, block->insn_count, section[block->section].name);
+        if(label_repository_find(repository, block->logical, block->page, &name)) {
+            emitter_string(out, ", \"label\":\"");
+            emitter_string(out, name);
+            emitter_char(out, '"');
+        }
+        emitter_string(out, ", \"successors\":[");
+        for(j=0; j<block->edge_count; j++) {
+            const flow_edge_t *edge = &graph->edge[block->edge + j];
+            emitter_string(out, j ? ", { \"logical\":\"" : " { \"logical\":\"");
+            emitter_hex16(out, edge->logical);
+            emitter_string(out, "\", \"page\":\"");
+            emitter_hex8(out, edge->page);
+            emitter_string(out, "\", \"kind\":\"");
+            emitter_string(out, flow_edge_kind_name[edge->kind]);
+            emitter_char(out, '"');
+            if(edge->block != FLOW_EXTERNAL) {
+                emitter_printf(out, ", \"id\":%u", edge->block);
+            }
+            emitter_string(out, " }");
+        }
+        emitter_string(out, j ? " ] }" : "] }");
+        emitter_string(out, ((i+1) < graph->block_count) ? ",\n" : "\n");
+    }
+    emitter_string(out, "]\n");
+}
+
+/* Save control flow graph as a Graphviz DOT file. */
+int flow_graph_save_dot(const char *filename, const flow_graph_t *graph, const section_t *section, label_repository_t *repository) {
+    flow_graph_output_t output = { graph, section, repository };
+    return emitter_save(filename, flow_graph_write_dot, &output);
+}
+
+/* Save control flow graph as a JSON file. */
+int flow_graph_save_json(const char *filename, const flow_graph_t *graph, const section_t *section, label_repository_t *repository) {
+    flow_graph_output_t output = { graph, section, repository };
+    return emitter_save(filename, flow_graph_write_json, &output);
+}
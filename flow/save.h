@@ -0,0 +1,45 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_FLOW_SAVE_H
+#define ETRIPATOR_FLOW_SAVE_H
+
+#include "../flow.h"
+#include "../label.h"
+
+/**
+ * Save control flow graph as a Graphviz DOT file.
+ * Nodes are named after the page and logical address of the block start.
+ * \param [in] filename   Output filename.
+ * \param [in] graph      Control flow graph.
+ * \param [in] section    Sections.
+ * \param [in] repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int flow_graph_save_dot(const char *filename, const flow_graph_t *graph, const section_t *section, label_repository_t *repository);
+
+/**
+ * Save control flow graph as a JSON file.
+ * \param [in] filename   Output filename.
+ * \param [in] graph      Control flow graph.
+ * \param [in] section    Sections.
+ * \param [in] repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int flow_graph_save_json(const char *filename, const flow_graph_t *graph, const section_t *section, label_repository_t *repository);
+
+#endif // ETRIPATOR_FLOW_SAVE_H
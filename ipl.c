@@ -18,96 +18,43 @@
 
 #include "ipl.h"
 #include "message.h"
+#include "cd/reader.h"
 
-#define IPL_DATA_SIZE 0xb2
+/* Copy a field from the IPL block and return a pointer to the next one. */
+static const uint8_t* ipl_field(uint8_t *out, const uint8_t *in, size_t len) {
+    memcpy(out, in, len);
+    return in + len;
+}
 
-static int ipl_read_header(ipl_t *out, FILE *in, const char *filename) {
-    size_t nRead;
-    nRead = fread(out->load_start_record, 1, 3, in);
-    if(nRead != 3) {
-        ERROR_MSG("Failed to read IPLBLK from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(&out->load_sector_count, 1, 1, in);
-    if(nRead != 1) {
-        ERROR_MSG("Failed to read IPLBLN from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->load_store_address, 1, 2, in);
-    if(nRead != 2) {
-        ERROR_MSG("Failed to read IPLSTA from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->load_exec_address, 1, 2, in);
-    if(nRead != 2) {
-        ERROR_MSG("Failed to read IPLJMP from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->mpr, 1, 5, in);
-    if(nRead != 5) {
-        ERROR_MSG("Failed to read IPLMPR from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(&out->opening_mode, 1, 1, in);
-    if(nRead != 1) {
-        ERROR_MSG("Failed to read OPENMODE from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->opening_gfx_record, 1, 3, in);
-    if(nRead != 3) {
-        ERROR_MSG("Failed to read GRPBLK from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(&out->opening_gfx_sector_count, 1, 1, in);
-    if(nRead != 1) {
-        ERROR_MSG("Failed to read GRPBLN from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->opening_gfx_read_address, 1, 2, in);
-    if(nRead != 2) {
-        ERROR_MSG("Failed to read GRPADR from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->opening_adpcm_record, 1, 3, in);
-    if(nRead != 3) {
-        ERROR_MSG("Failed to read ADPBLK from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(&out->opening_adpcm_sector_count, 1, 1, in);
-    if(nRead != 1) {
-        ERROR_MSG("Failed to read ADPBLN from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(&out->opening_adpcm_sampling_rate, 1, 1, in);
-    if(nRead != 1) {
-        ERROR_MSG("Failed to read ADPRATE from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->reserved, 1, 7, in);
-    if(nRead != 7) {
-        ERROR_MSG("Failed to read RESERVED from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->id, 1, 24, in);
-    if(nRead != 24) {
-        ERROR_MSG("Failed to read ID STR from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->legal, 1, 50, in);
-    if(nRead != 50) {
-        ERROR_MSG("Failed to read LEGAL from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->program_name, 1, 16, in);
-    if(nRead != 16) {
-        ERROR_MSG("Failed to read PROGRAM NAME from %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    nRead = fread(out->extra, 1, 6, in);
-    if(nRead != 6) {
-        ERROR_MSG("Failed to read EXTRA from %s: %s", filename, strerror(errno));
-        return 0;
-    }
+/**
+ * Decode IPL data.
+ * \param [out] out    IPL infos.
+ * \param [in]  buffer IPL block (starting at IPLBLK).
+ * \param [in]  len    IPL block size (in bytes).
+ * \return 0 if the buffer is too small, 1 otherwise.
+ */
+int ipl_parse_buffer(ipl_t *out, const uint8_t *buffer, size_t len) {
+    const uint8_t *ptr = buffer;
+    if(len < IPL_DATA_SIZE) {
+        return 0;
+    }
+    ptr = ipl_field(out->load_start_record, ptr, 3);
+    ptr = ipl_field(&out->load_sector_count, ptr, 1);
+    ptr = ipl_field(out->load_store_address, ptr, 2);
+    ptr = ipl_field(out->load_exec_address, ptr, 2);
+    ptr = ipl_field(out->mpr, ptr, 5);
+    ptr = ipl_field(&out->opening_mode, ptr, 1);
+    ptr = ipl_field(out->opening_gfx_record, ptr, 3);
+    ptr = ipl_field(&out->opening_gfx_sector_count, ptr, 1);
+    ptr = ipl_field(out->opening_gfx_read_address, ptr, 2);
+    ptr = ipl_field(out->opening_adpcm_record, ptr, 3);
+    ptr = ipl_field(&out->opening_adpcm_sector_count, ptr, 1);
+    ptr = ipl_field(&out->opening_adpcm_sampling_rate, ptr, 1);
+    ptr = ipl_field(out->reserved, ptr, 7);
+    ptr = ipl_field(out->id, ptr, 24);
+    ptr = ipl_field(out->legal, ptr, 50);
+    ptr = ipl_field(out->program_name, ptr, 16);
+    (void)ipl_field(out->extra, ptr, 6);
     return 1;
 }
 
@@ -139,19 +86,21 @@ void ipl_print(ipl_t *in) {
  * \return 0 on error, 1 otherwise.
  */
 int ipl_read(ipl_t *out, const char *filename) {
-    FILE *in = fopen(filename, "rb");
-    if(in == NULL) {
-        ERROR_MSG("Failed to open %s: %s", filename, strerror(errno));
+    cd_reader_t in;
+    if(!cd_reader_open(&in, filename)) {
         return 0;
     }
 
-    int ret = 0;
-    fseek(in, 0x800, SEEK_SET);
-    ret = ipl_read_header(out, in, filename);
-    if(ret) {
+    uint8_t buffer[IPL_DATA_SIZE];
+    int ret = cd_reader_read(&in, IPL_OFFSET, buffer, IPL_DATA_SIZE);
+    if(!ret) {
+        ERROR_MSG("Failed to read IPL data from %s", filename);
+    }
+    else {
+        ret = ipl_parse_buffer(out, buffer, IPL_DATA_SIZE);
         ipl_print(out);
     }
-    fclose(in);
+    cd_reader_close(&in);
     return ret;
 }
 
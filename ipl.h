@@ -21,6 +21,15 @@
 #include "config.h"
 #include "section.h"
 
+/**
+ * IPL block offset in the data track.
+ */
+#define IPL_OFFSET 0x800
+/**
+ * IPL block size (in bytes).
+ */
+#define IPL_DATA_SIZE 0xb2
+
 /**
  * IPL Information block data format
  */
@@ -82,6 +91,15 @@ typedef struct {
  */
 void ipl_print(ipl_t *in);
 
+/**
+ * Decode IPL data.
+ * \param [out] out    IPL infos.
+ * \param [in]  buffer IPL block (starting at IPLBLK).
+ * \param [in]  len    IPL block size (in bytes).
+ * \return 0 if the buffer is too small, 1 otherwise.
+ */
+int ipl_parse_buffer(ipl_t *out, const uint8_t *buffer, size_t len);
+
 /**
  * Read IPL data from file.
  * \param [out] out IPL infos.
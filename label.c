@@ -18,28 +18,244 @@
 #include "label.h"
 #include "message.h"
 
-#define LABEL_ARRAY_INC 16
+#define LABEL_ARRAY_MIN_SIZE 16
+#define LABEL_NAME_CHUNK_MIN_SIZE 4096
+#define LABEL_INDEX_MIN_SIZE 64
+#define LABEL_INDEX_EMPTY ((uint32_t)-1)
+#define LABEL_INDEX_DELETED ((uint32_t)-2)
+#define LABEL_SLOT_NONE ((size_t)-1)
+#define LABEL_PRESENCE_SIZE ((0x100 * 0x2000) / 8)
 
 /**
  * Label.
  */
 typedef struct {
-    size_t   name;    /**< Offset in the repository name buffer */
-    uint16_t logical; /**< Logical address */
-    uint8_t  page;    /**< Memory page  */
+    const char *name;  /**< Name (stored in the repository name arena) */
+    uint16_t logical;  /**< Logical address */
+    uint8_t  page;     /**< Memory page  */
+    uint8_t  deleted;  /**< Set if the label was deleted */
 } label_t;
 
+/**
+ * Label name arena chunk.
+ */
+typedef struct label_name_chunk_t_ {
+    struct label_name_chunk_t_ *next; /**< Previously allocated chunk */
+    size_t used;                      /**< Number of bytes used */
+    size_t capacity;                  /**< Chunk capacity */
+    char data[];                      /**< Label names */
+} label_name_chunk_t;
+
 /**
  * Label repository.
  */
 struct label_repository_impl {
     size_t size;            /**< Size of label repository */
-    size_t last;            /**< Last element in the repository */
+    size_t last;            /**< Last element in the repository (deleted labels included) */
+    size_t count;           /**< Number of labels (deleted labels excluded) */
     label_t *labels;        /**< Labels */
-    size_t name_buffer_len; /**< Label name buffer length */
-    char   *name_buffer;    /**< Label name buffer */
+    label_name_chunk_t *names; /**< Label name arena (current chunk) */
+    size_t index_size;      /**< Number of slots in the address index (power of 2) */
+    size_t index_used;      /**< Number of used or deleted slots in the address index */
+    uint32_t *index;        /**< Open addressing (page, logical) index. Each slot holds a label id */
+    uint32_t *name_index;   /**< Open addressing name index. It has the same size as the address index */
+    uint8_t *presence;      /**< One bit per byte of each 8KB page. Set if a label may exist at this address */
+    uint32_t *sorted;       /**< Label ids ordered by page and logical address */
+    int sorted_valid;       /**< Set if the sorted view is up to date */
 };
 
+/* Bit index of a (page, logical) pair in the presence bitmap */
+static size_t label_presence_bit(uint16_t logical, uint8_t page) {
+    return ((size_t)page << 13) | (logical & 0x1fff);
+}
+
+static void label_presence_set(label_repository_t* repository, uint16_t logical, uint8_t page) {
+    size_t bit = label_presence_bit(logical, page);
+    repository->presence[bit >> 3] |= 1 << (bit & 7);
+}
+
+static int label_presence_test(label_repository_t* repository, uint16_t logical, uint8_t page) {
+    size_t bit = label_presence_bit(logical, page);
+    return (repository->presence[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/* Compute the address index slot of a (page, logical) pair */
+static size_t label_index_hash(uint16_t logical, uint8_t page, size_t index_size) {
+    uint32_t key = ((uint32_t)page << 16) | logical;
+    key *= 0x9e3779b1;
+    key ^= key >> 15;
+    return key & (index_size - 1);
+}
+
+/* Compute the name index slot of a label name (FNV-1a) */
+static size_t label_name_hash(const char *name, size_t index_size) {
+    uint32_t key = 0x811c9dc5;
+    for(; *name; name++) {
+        key ^= (uint8_t)*name;
+        key *= 0x01000193;
+    }
+    return key & (index_size - 1);
+}
+
+/* Insert label id into the address and name indices (the indices must have at least one free slot) */
+static void label_index_insert(label_repository_t* repository, uint32_t id) {
+    const label_t *label = &repository->labels[id];
+    size_t mask = repository->index_size - 1;
+    size_t slot = label_index_hash(label->logical, label->page, repository->index_size);
+    while(repository->index[slot] != LABEL_INDEX_EMPTY) {
+        slot = (slot + 1) & mask;
+    }
+    repository->index[slot] = id;
+    slot = label_name_hash(label->name, repository->index_size);
+    while(repository->name_index[slot] != LABEL_INDEX_EMPTY) {
+        slot = (slot + 1) & mask;
+    }
+    repository->name_index[slot] = id;
+    repository->index_used++;
+}
+
+/* (Re)build address and name indices with the specified number of slots */
+static int label_index_build(label_repository_t* repository, size_t index_size) {
+    size_t i;
+    uint32_t *index = (uint32_t*)realloc(repository->index, index_size * sizeof(uint32_t));
+    if(index == NULL) {
+        ERROR_MSG("Failed to allocate label index: %s", strerror(errno));
+        return 0;
+    }
+    repository->index = index;
+    index = (uint32_t*)realloc(repository->name_index, index_size * sizeof(uint32_t));
+    if(index == NULL) {
+        ERROR_MSG("Failed to allocate label name index: %s", strerror(errno));
+        return 0;
+    }
+    repository->name_index = index;
+    repository->index_size = index_size;
+    repository->index_used = 0;
+    memset(repository->index, 0xff, index_size * sizeof(uint32_t));
+    memset(repository->name_index, 0xff, index_size * sizeof(uint32_t));
+    for(i=0; i<repository->last; i++) {
+        if(!repository->labels[i].deleted) {
+            label_index_insert(repository, (uint32_t)i);
+        }
+    }
+    return 1;
+}
+
+/* Retrieve the address index slot of the label stored at the specified address, or LABEL_SLOT_NONE */
+static size_t label_index_slot(label_repository_t* repository, uint16_t logical, uint8_t page) {
+    size_t mask = repository->index_size - 1;
+    size_t slot = label_index_hash(logical, page, repository->index_size);
+    uint32_t id;
+    while((id = repository->index[slot]) != LABEL_INDEX_EMPTY) {
+        if((id != LABEL_INDEX_DELETED) && (repository->labels[id].logical == logical) && (repository->labels[id].page == page)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return LABEL_SLOT_NONE;
+}
+
+/* Retrieve the name index slot of the specified label, or LABEL_SLOT_NONE */
+static size_t label_name_index_slot(label_repository_t* repository, uint32_t id) {
+    size_t mask = repository->index_size - 1;
+    size_t slot = label_name_hash(repository->labels[id].name, repository->index_size);
+    uint32_t current;
+    while((current = repository->name_index[slot]) != LABEL_INDEX_EMPTY) {
+        if(current == id) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return LABEL_SLOT_NONE;
+}
+
+/* Retrieve the id of a label by its name, or LABEL_INDEX_EMPTY */
+static uint32_t label_name_index_find(label_repository_t* repository, const char *name) {
+    size_t mask = repository->index_size - 1;
+    size_t slot = label_name_hash(name, repository->index_size);
+    uint32_t id;
+    while((id = repository->name_index[slot]) != LABEL_INDEX_EMPTY) {
+        if((id != LABEL_INDEX_DELETED) && !strcmp(repository->labels[id].name, name)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return id;
+}
+
+/* Retrieve the id of the label stored at the specified address, or LABEL_INDEX_EMPTY */
+static uint32_t label_index_find(label_repository_t* repository, uint16_t logical, uint8_t page) {
+    size_t slot = label_index_slot(repository, logical, page);
+    return (slot == LABEL_SLOT_NONE) ? LABEL_INDEX_EMPTY : repository->index[slot];
+}
+
+static int label_sort_key_compare(const void *a, const void *b) {
+    uint64_t k0 = *(const uint64_t*)a;
+    uint64_t k1 = *(const uint64_t*)b;
+    return (k0 < k1) ? -1 : ((k0 > k1) ? 1 : 0);
+}
+
+/* Rebuild the sorted view if labels were added or deleted since the last time it was built */
+static int label_sorted_update(label_repository_t* repository) {
+    size_t i, j;
+    uint64_t *keys;
+    uint32_t *sorted;
+    if(repository->sorted_valid) {
+        return 1;
+    }
+    sorted = (uint32_t*)realloc(repository->sorted, (repository->count + 1) * sizeof(uint32_t));
+    if(sorted == NULL) {
+        ERROR_MSG("Failed to allocate sorted label view: %s", strerror(errno));
+        return 0;
+    }
+    repository->sorted = sorted;
+    keys = (uint64_t*)malloc((repository->count + 1) * sizeof(uint64_t));
+    if(keys == NULL) {
+        ERROR_MSG("Failed to allocate sorted label view: %s", strerror(errno));
+        return 0;
+    }
+    /* The key is page:logical:id so that the label id can be retrieved after sorting */
+    for(i=0, j=0; i<repository->last; i++) {
+        if(!repository->labels[i].deleted) {
+            keys[j++] = ((uint64_t)repository->labels[i].page << 48) | ((uint64_t)repository->labels[i].logical << 32) | i;
+        }
+    }
+    qsort(keys, repository->count, sizeof(uint64_t), label_sort_key_compare);
+    for(i=0; i<repository->count; i++) {
+        sorted[i] = (uint32_t)keys[i];
+    }
+    free(keys);
+    repository->sorted_valid = 1;
+    return 1;
+}
+
+/* Copy name to the label name arena. The returned pointer stays valid until the repository is destroyed. */
+static const char* label_name_push(label_repository_t* repository, const char* name) {
+    char *out;
+    size_t len = strlen(name) + 1;
+    label_name_chunk_t *chunk = repository->names;
+    if((chunk == NULL) || ((chunk->used + len) > chunk->capacity)) {
+        /* Chunks grow geometrically so that the number of allocations stays logarithmic. */
+        size_t capacity = chunk ? (2 * chunk->capacity) : LABEL_NAME_CHUNK_MIN_SIZE;
+        if(capacity < len) {
+            capacity = len;
+        }
+        chunk = (label_name_chunk_t*)malloc(sizeof(label_name_chunk_t) + capacity);
+        if(chunk == NULL) {
+            ERROR_MSG("Failed to allocate label names: %s", strerror(errno));
+            return NULL;
+        }
+        chunk->next = repository->names;
+        chunk->used = 0;
+        chunk->capacity = capacity;
+        repository->names = chunk;
+    }
+    out = chunk->data + chunk->used;
+    memcpy(out, name, len);
+    chunk->used += len;
+    return out;
+}
+
 /**
  * Create label repository.
  * \return A pointer to a label repository or NULL if an error occured.
@@ -53,13 +269,28 @@ label_repository_t* label_repository_create() {
     }
     
     repository->last  = 0;
+    repository->count = 0;
 
-    repository->name_buffer     = NULL;
-    repository->name_buffer_len = 0;
+    repository->names = NULL;
 
     repository->labels = NULL;
 
-    repository->size = LABEL_ARRAY_INC;
+    repository->index      = NULL;
+    repository->name_index = NULL;
+    repository->index_size = 0;
+    repository->index_used = 0;
+
+    repository->sorted       = NULL;
+    repository->sorted_valid = 0;
+
+    repository->presence = (uint8_t*)calloc(LABEL_PRESENCE_SIZE, 1);
+    if(repository->presence == NULL) {
+        ERROR_MSG("Failed to create label presence bitmap: %s", strerror(errno));
+        free(repository);
+        return NULL;
+    }
+
+    repository->size = LABEL_ARRAY_MIN_SIZE;
     repository->labels = (label_t*)malloc(repository->size * sizeof(label_t));
     if(repository->labels == NULL) {
         ERROR_MSG("Failed to create label: %s", strerror(errno));
@@ -67,7 +298,13 @@ label_repository_t* label_repository_create() {
         free(repository);
         return NULL;
     }
-    
+
+    if(!label_index_build(repository, LABEL_INDEX_MIN_SIZE)) {
+        label_repository_destroy(repository);
+        free(repository);
+        return NULL;
+    }
+
     return repository;
 }
 
@@ -78,35 +315,89 @@ label_repository_t* label_repository_create() {
 void label_repository_destroy(label_repository_t* repository) {
     repository->size  = 0;
     repository->last  = 0;
-
-    repository->name_buffer_len = 0;
+    repository->count = 0;
 
     if(repository->labels != NULL) {
         free(repository->labels);
         repository->labels = NULL;
     }
 
-    if(repository->name_buffer != NULL) {
-        free(repository->name_buffer);
-        repository->name_buffer = NULL;
+    while(repository->names != NULL) {
+        label_name_chunk_t *next = repository->names->next;
+        free(repository->names);
+        repository->names = next;
+    }
+
+    repository->index_size = 0;
+    repository->index_used = 0;
+    if(repository->index != NULL) {
+        free(repository->index);
+        repository->index = NULL;
+    }
+    if(repository->name_index != NULL) {
+        free(repository->name_index);
+        repository->name_index = NULL;
+    }
+
+    if(repository->presence != NULL) {
+        free(repository->presence);
+        repository->presence = NULL;
+    }
+
+    repository->sorted_valid = 0;
+    if(repository->sorted != NULL) {
+        free(repository->sorted);
+        repository->sorted = NULL;
     }
 }
 
-/* Set name and add it to label name buffer */
-static int label_set(label_repository_t* repository, label_t *label, const char* name) {
-    char *tmp;
-    size_t name_len = strlen(name) + 1;
-    size_t len      = repository->name_buffer_len + name_len;
-    tmp = (char*)realloc(repository->name_buffer, len);
-    if(NULL == tmp) {
+/* Make room for the specified number of extra labels */
+static int label_reserve(label_repository_t* repository, size_t extra) {
+    size_t size = repository->size;
+    while((repository->last + extra) > size) {
+        size *= 2;
+    }
+    if(size != repository->size) {
+        label_t *ptr = (label_t*)realloc(repository->labels, size * sizeof(label_t));
+        if(ptr == NULL) {
+            ERROR_MSG("Failed to allocate labels: %s", strerror(errno));
+            return 0;
+        }
+        repository->labels = ptr;
+        repository->size = size;
+    }
+
+    /* Keep the address index at most half full (deleted slots included) */
+    if((2 * (repository->index_used + extra)) > repository->index_size) {
+        size_t index_size = LABEL_INDEX_MIN_SIZE;
+        while((4 * (repository->count + extra)) > index_size) {
+            index_size *= 2;
+        }
+        if(!label_index_build(repository, index_size)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Append a new label. Room must have been made with label_reserve. */
+static int label_push(label_repository_t* repository, const char* name, uint16_t logical, uint8_t page) {
+    label_t *label = &repository->labels[repository->last];
+    label->logical = logical;
+    label->page    = page;
+    label->deleted = 0;
+    
+    label->name = label_name_push(repository, name);
+    if(label->name == NULL) {
         return 0;
     }
 
-    label->name = repository->name_buffer_len;
-    memcpy(tmp+label->name, name, name_len);
+    label_index_insert(repository, (uint32_t)repository->last);
+    label_presence_set(repository, logical, page);
+    repository->sorted_valid = 0;
 
-    repository->name_buffer     = tmp;
-    repository->name_buffer_len = len;
+    ++repository->last;
+    ++repository->count;
     return 1;
 }
 
@@ -119,6 +410,7 @@ static int label_set(label_repository_t* repository, label_t *label, const char*
  */
 int label_repository_add(label_repository_t* repository, const char* name, uint16_t logical, uint8_t page) {
     char *dummy;
+    uint32_t id;
 
     if(label_repository_find(repository, logical, page, &dummy)) {
         if(strcmp(name, dummy)) {
@@ -127,30 +419,139 @@ int label_repository_add(label_repository_t* repository, const char* name, uint1
         return  1;
     }
 
-    /* Expand arrays if necessary */
-    if(repository->last >= repository->size) {
-        label_t *ptr;
-        repository->size += LABEL_ARRAY_INC;
-        
-        ptr = (label_t*)realloc(repository->labels, repository->size * sizeof(label_t));
-        if(ptr == NULL) {
+    id = label_name_index_find(repository, name);
+    if(id != LABEL_INDEX_EMPTY) {
+        WARNING_MSG("Label %s is already defined at %02x:%04x", name, repository->labels[id].page, repository->labels[id].logical);
+    }
+
+    if(!label_reserve(repository, 1) || !label_push(repository, name, logical, page)) {
+        label_repository_destroy(repository);
+        return 0;
+    }
+    return 1;
+}
+
+static int label_address_compare(const void *a, const void *b) {
+    const label_address_t *a0 = (const label_address_t*)a;
+    const label_address_t *a1 = (const label_address_t*)b;
+    int cmp = a0->page - a1->page;
+    if(!cmp) {
+        cmp = a0->logical - a1->logical;
+    }
+    return cmp;
+}
+
+/* Build the l<logical>_<page> name of an automatically generated label. */
+static void label_auto_name(char *out, uint16_t logical, uint8_t page) {
+    static const char hex[] = "0123456789abcdef";
+    *out++ = 'l';
+    *out++ = hex[(logical >> 12) & 0x0f];
+    *out++ = hex[(logical >>  8) & 0x0f];
+    *out++ = hex[(logical >>  4) & 0x0f];
+    *out++ = hex[ logical        & 0x0f];
+    *out++ = '_';
+    /* The page is written in decimal with at least 2 digits. */
+    if(page >= 100) {
+        *out++ = '0' + (page / 100);
+    }
+    *out++ = '0' + ((page / 10) % 10);
+    *out++ = '0' + (page % 10);
+    *out = '\0';
+}
+
+/**
+ * Add a batch of automatically named labels to the repository.
+ * \param [in,out] repository Label repository.
+ * \param [in,out] addresses  Label addresses.
+ * \param [in]     count      Number of addresses.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int label_repository_add_batch(label_repository_t* repository, label_address_t* addresses, size_t count) {
+    size_t i, n;
+    char name[16];
+    if(count == 0) {
+        return 1;
+    }
+    /* Sort and remove duplicates. */
+    qsort(addresses, count, sizeof(label_address_t), label_address_compare);
+    for(i=1, n=1; i<count; i++) {
+        if(label_address_compare(&addresses[n-1], &addresses[i])) {
+            addresses[n++] = addresses[i];
+        }
+    }
+    if(!label_reserve(repository, n)) {
+        label_repository_destroy(repository);
+        return 0;
+    }
+    for(i=0; i<n; i++) {
+        uint16_t logical = addresses[i].logical;
+        uint8_t page = addresses[i].page;
+        if(label_presence_test(repository, logical, page) && (label_index_find(repository, logical, page) != LABEL_INDEX_EMPTY)) {
+            continue;
+        }
+        label_auto_name(name, logical, page);
+        if(!label_push(repository, name, logical, page)) {
             label_repository_destroy(repository);
             return 0;
         }
-        repository->labels = ptr;
     }
-    
-    /* Push addresses */
-    repository->labels[repository->last].logical = logical;
-    repository->labels[repository->last].page    = page;
-    
-    /* Push name */
-    if(!label_set(repository, &repository->labels[repository->last], name)) {
+    return 1;
+}
+
+/**
+ * Add a block of packed labels to the repository.
+ * \param [in,out] repository Label repository.
+ * \param [in]     entries    Label entries.
+ * \param [in]     count      Number of entries.
+ * \param [in]     names      Label name block.
+ * \param [in]     names_size Size of the label name block.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int label_repository_add_block(label_repository_t* repository, const label_entry_t* entries, size_t count, const char* names, size_t names_size) {
+    label_name_chunk_t *chunk;
+    size_t i;
+    if(count == 0) {
+        return 1;
+    }
+    if(!label_reserve(repository, count)) {
         label_repository_destroy(repository);
         return 0;
     }
-
-    ++repository->last;
+    chunk = (label_name_chunk_t*)malloc(sizeof(label_name_chunk_t) + names_size);
+    if(chunk == NULL) {
+        ERROR_MSG("Failed to allocate label names: %s", strerror(errno));
+        label_repository_destroy(repository);
+        return 0;
+    }
+    memcpy(chunk->data, names, names_size);
+    chunk->used = chunk->capacity = names_size;
+    /* The block is full. Keep it behind the current chunk so that the latter can still be filled. */
+    if(repository->names) {
+        chunk->next = repository->names->next;
+        repository->names->next = chunk;
+    }
+    else {
+        chunk->next = NULL;
+        repository->names = chunk;
+    }
+    for(i=0; i<count; i++) {
+        uint16_t logical = entries[i].logical;
+        uint8_t page = entries[i].page;
+        label_t *label;
+        if(label_presence_test(repository, logical, page) && (label_index_find(repository, logical, page) != LABEL_INDEX_EMPTY)) {
+            continue;
+        }
+        label = &repository->labels[repository->last];
+        label->name    = chunk->data + entries[i].name;
+        label->logical = logical;
+        label->page    = page;
+        label->deleted = 0;
+        label_index_insert(repository, (uint32_t)repository->last);
+        label_presence_set(repository, logical, page);
+        ++repository->last;
+        ++repository->count;
+    }
+    repository->sorted_valid = 0;
     return 1;
 }
 
@@ -163,18 +564,36 @@ int label_repository_add(label_repository_t* repository, const char* name, uint1
  * \return 1 if a label was found, 0 otherwise.
  */
 int label_repository_find(label_repository_t* repository, uint16_t logical, uint8_t page, char** name) {
-    size_t i;
-    for(i=0; i<repository->last; i++) {
-        if( (repository->labels[i].page == page) &&
-            (repository->labels[i].logical == logical) ) {
-            *name = repository->name_buffer + repository->labels[i].name;
-            return 1;
-        }
+    uint32_t id = LABEL_INDEX_EMPTY;
+    if(label_presence_test(repository, logical, page)) {
+        id = label_index_find(repository, logical, page);
+    }
+    if(id != LABEL_INDEX_EMPTY) {
+        *name = (char*)repository->labels[id].name;
+        return 1;
     }
     *name = "";
     return 0;
 }
 
+/**
+ * Find a label by its name.
+ * \param [in]  repository  Label repository.
+ * \param [in]  name        Label name.
+ * \param [out] logical     Logical address (if found).
+ * \param [out] page        Memory page (if found).
+ * \return 1 if a label was found, 0 otherwise.
+ */
+int label_repository_find_by_name(label_repository_t* repository, const char* name, uint16_t* logical, uint8_t* page) {
+    uint32_t id = label_name_index_find(repository, name);
+    if(id != LABEL_INDEX_EMPTY) {
+        *logical = repository->labels[id].logical;
+        *page = repository->labels[id].page;
+        return 1;
+    }
+    return 0;
+}
+
 /**
  * Get the number of labels stored in the repository.
  * \param [in] repository Label repository.
@@ -184,11 +603,12 @@ int label_repository_size(label_repository_t* repository) {
     if(repository == NULL) {
         return 0;
     }
-    return (int)repository->last;
+    return (int)repository->count;
 }
 
 /**
  * Retrieve the label at the specified index.
+ * Labels are ordered by page and logical address.
  * \param [in] repository Label repository.
  * \param [in] index      Label index.
  * \param [out] logical   Logical address.
@@ -204,19 +624,78 @@ int label_repository_get(label_repository_t* repository, int index, uint16_t* lo
         return 0;
     }
     else {
-        int end = (int)repository->last;
+        label_t *label;
+        int end = (int)repository->count;
         if((index < 0) || (index >= end)) {
             return 0;
         }
-        if(repository->labels[index].name >= repository->name_buffer_len) {
+        if(!label_sorted_update(repository)) {
             return 0;
         }
-        *logical = repository->labels[index].logical;
-        *page = repository->labels[index].page;
-        *name = repository->name_buffer + repository->labels[index].name;
+        label = &repository->labels[repository->sorted[index]];
+        *logical = label->logical;
+        *page = label->page;
+        *name = (char*)label->name;
         return 1;
     }
 }
+
+/**
+ * Find the position of the first label located at or after the specified address.
+ * \param [in] repository Label repository.
+ * \param [in] logical    Logical address.
+ * \param [in] page       Memory page.
+ * \return Cursor position.
+ */
+int label_repository_seek(label_repository_t* repository, uint16_t logical, uint8_t page) {
+    size_t first, count;
+    uint32_t key = ((uint32_t)page << 16) | logical;
+    if(!label_sorted_update(repository)) {
+        return (int)repository->count;
+    }
+    /* Lower bound */
+    for(first=0, count=repository->count; count > 0; ) {
+        size_t step = count / 2;
+        const label_t *label = &repository->labels[repository->sorted[first + step]];
+        if(((((uint32_t)label->page) << 16) | label->logical) < key) {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+    return (int)first;
+}
+
+/**
+ * Retrieve the label at the cursor position if it belongs to the specified page and
+ * lies before the end of the logical address range. The cursor is then moved to the next label.
+ * \param [in]     repository Label repository.
+ * \param [in,out] cursor     Cursor position.
+ * \param [in]     end        End of the logical address range (excluded).
+ * \param [in]     page       Memory page.
+ * \param [out]    logical    Logical address.
+ * \param [out]    name       Label name.
+ * \return 1 if a label was found, 0 otherwise.
+ */
+int label_repository_next_in_range(label_repository_t* repository, int *cursor, uint32_t end, uint8_t page, uint16_t *logical, char **name) {
+    const label_t *label;
+    if(!label_sorted_update(repository)) {
+        return 0;
+    }
+    if((*cursor < 0) || (*cursor >= (int)repository->count)) {
+        return 0;
+    }
+    label = &repository->labels[repository->sorted[*cursor]];
+    if((label->page != page) || (label->logical >= end)) {
+        return 0;
+    }
+    *logical = label->logical;
+    *name = (char*)label->name;
+    ++*cursor;
+    return 1;
+}
 /**
  * Delete labels
  * \param [in]  repository  Label repository.
@@ -225,27 +704,33 @@ int label_repository_get(label_repository_t* repository, int index, uint16_t* lo
  * \param [in]  page        Memory page.
  */
 int label_repository_delete(label_repository_t* repository, uint16_t first, uint16_t end, uint8_t page) {
-    size_t i;        
+    size_t i;
+    /* Deleted labels are only flagged. Their names stay in the arena. */
     for(i=0; i<repository->last; i++) {
-        if( (repository->labels[i].page == page) &&
-            (repository->labels[i].logical >= first) && 
-            (repository->labels[i].logical < end) ) {
-            if(repository->last) {
-                repository->last--;
-                memcpy(&repository->labels[i], &repository->labels[repository->last], sizeof(label_t));
-                i--;
+        label_t *label = &repository->labels[i];
+        if( !label->deleted &&
+            (label->page == page) &&
+            (label->logical >= first) && 
+            (label->logical < end) ) {
+            size_t slot = label_index_slot(repository, label->logical, label->page);
+            if(slot != LABEL_SLOT_NONE) {
+                repository->index[slot] = LABEL_INDEX_DELETED;
+            }
+            slot = label_name_index_slot(repository, (uint32_t)i);
+            if(slot != LABEL_SLOT_NONE) {
+                repository->name_index[slot] = LABEL_INDEX_DELETED;
             }
+            label->deleted = 1;
+            repository->count--;
+            repository->sorted_valid = 0;
         }
     }
-    int ret = 1;
-    char *tmp = repository->name_buffer;
-    repository->name_buffer_len = 0;
-    repository->name_buffer     = NULL;
-    for(i=0; ret && (i<repository->last); i++) {
-        ret = label_set(repository, &repository->labels[i], tmp + repository->labels[i].name);
-    }    
-    if(tmp) {
-        free(tmp);
+    /* Reset the presence bits of the page as other logical ranges may be mapped to the same bits. */
+    memset(repository->presence + (label_presence_bit(0, page) >> 3), 0, 0x2000 / 8);
+    for(i=0; i<repository->last; i++) {
+        if(!repository->labels[i].deleted && (repository->labels[i].page == page)) {
+            label_presence_set(repository, repository->labels[i].logical, page);
+        }
     }
-    return ret;
+    return 1;
 }
@@ -22,6 +22,25 @@
 
 typedef struct label_repository_impl label_repository_t;
 
+/**
+ * Label address.
+ */
+typedef struct {
+    uint16_t logical; /**< Logical address */
+    uint8_t  page;    /**< Memory page */
+} label_address_t;
+
+/**
+ * Packed label entry.
+ * The label name is stored in a separate block of null terminated strings.
+ */
+typedef struct {
+    uint32_t name;    /**< Offset of the label name in the name block */
+    uint16_t logical; /**< Logical address */
+    uint8_t  page;    /**< Memory page */
+    uint8_t  reserved;
+} label_entry_t;
+
 /**
  * Create label repository.
  * \return A pointer to a label repository or NULL if an error occured.
@@ -43,6 +62,31 @@ void label_repository_destroy(label_repository_t* repository);
  */
 int label_repository_add(label_repository_t* repository, const char* name, uint16_t logical, uint8_t page);
 
+/**
+ * Add a batch of automatically named labels to the repository.
+ * The addresses are sorted and duplicates are removed in place. A label named l<logical>_<page>
+ * (logical in hexadecimal, page in decimal) is created for each address without any label.
+ * \param [in,out] repository Label repository.
+ * \param [in,out] addresses  Label addresses.
+ * \param [in]     count      Number of addresses.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int label_repository_add_batch(label_repository_t* repository, label_address_t* addresses, size_t count);
+
+/**
+ * Add a block of packed labels to the repository.
+ * The name block is copied as is to the repository and the labels point directly into it.
+ * Labels whose address is already used are skipped. Unlike label_repository_add, names are
+ * not checked for duplicates.
+ * \param [in,out] repository Label repository.
+ * \param [in]     entries    Label entries.
+ * \param [in]     count      Number of entries.
+ * \param [in]     names      Label name block.
+ * \param [in]     names_size Size of the label name block.
+ * \return 1 upon success, 0 if an error occured. The repository is destroyed in the latter case.
+ */
+int label_repository_add_block(label_repository_t* repository, const label_entry_t* entries, size_t count, const char* names, size_t names_size);
+
 /**
  * Find a label by its address.
  * \param [in]  repository  Label repository.
@@ -53,6 +97,17 @@ int label_repository_add(label_repository_t* repository, const char* name, uint1
  */
 int label_repository_find(label_repository_t* repository, uint16_t logical, uint8_t page, char** name);
 
+/**
+ * Find a label by its name.
+ * If several labels share the same name, any of them may be returned.
+ * \param [in]  repository  Label repository.
+ * \param [in]  name        Label name.
+ * \param [out] logical     Logical address (if found).
+ * \param [out] page        Memory page (if found).
+ * \return 1 if a label was found, 0 otherwise.
+ */
+int label_repository_find_by_name(label_repository_t* repository, const char* name, uint16_t* logical, uint8_t* page);
+
 /**
  * Get the number of labels stored in the repository.
  * \param [in] repository Label repository.
@@ -62,6 +117,7 @@ int label_repository_size(label_repository_t* repository);
 
 /**
  * Retrieve the label at the specified index.
+ * Labels are ordered by page and logical address.
  * \param [in] repository Label repository.
  * \param [in] index      Label index.
  * \param [out] logical   Logical address.
@@ -71,6 +127,29 @@ int label_repository_size(label_repository_t* repository);
  */
 int label_repository_get(label_repository_t* repository, int index, uint16_t* logical, uint8_t* page, char** name);
 
+/**
+ * Find the position of the first label located at or after the specified address.
+ * Labels are ordered by page and logical address.
+ * \param [in] repository Label repository.
+ * \param [in] logical    Logical address.
+ * \param [in] page       Memory page.
+ * \return Cursor position.
+ */
+int label_repository_seek(label_repository_t* repository, uint16_t logical, uint8_t page);
+
+/**
+ * Retrieve the label at the cursor position if it belongs to the specified page and
+ * lies before the end of the logical address range. The cursor is then moved to the next label.
+ * \param [in]     repository Label repository.
+ * \param [in,out] cursor     Cursor position (as returned by label_repository_seek).
+ * \param [in]     end        End of the logical address range (excluded).
+ * \param [in]     page       Memory page.
+ * \param [out]    logical    Logical address.
+ * \param [out]    name       Label name.
+ * \return 1 if a label was found, 0 otherwise.
+ */
+int label_repository_next_in_range(label_repository_t* repository, int *cursor, uint32_t end, uint8_t page, uint16_t *logical, char **name);
+
 /**
  * Delete labels
  * \param [in]  repository  Label repository.
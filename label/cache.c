@@ -0,0 +1,147 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cache.h"
+#include "../filemap.h"
+#include "../message.h"
+
+#define LABEL_CACHE_MAGIC "ELBC"
+#define LABEL_CACHE_VERSION 3
+
+/**
+ * Binary label cache header.
+ * It is followed by the label entries and the label name block.
+ * Values are stored in host byte order.
+ */
+typedef struct {
+    char     magic[4];   /**< "ELBC" **/
+    uint32_t version;    /**< Cache format version. **/
+    label_cache_stamp_t stamp; /**< Stamp of the label file. **/
+    uint32_t count;      /**< Number of label entries. **/
+    uint32_t names_size; /**< Size of the label name block. **/
+} label_cache_header_t;
+
+/**
+ * Compute the stamp of a label file.
+ * \param [in]  data  Label file content.
+ * \param [in]  len   Label file size (in bytes).
+ * \param [out] stamp Label file stamp.
+ */
+void label_cache_stamp(const uint8_t *data, size_t len, label_cache_stamp_t *stamp) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+    for(i=0; i<len; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    stamp->size = (uint64_t)len;
+    stamp->hash = hash;
+}
+
+/**
+ * Load labels from a binary cache file.
+ * \param [in]  filename   Cache filename.
+ * \param [in]  stamp      Stamp of the label file the cache was built from.
+ * \param [out] repository Label repository.
+ * \return 1 if the labels were loaded from the cache.
+ *         0 if the cache is missing, outdated or invalid. The repository is left untouched.
+ *        -1 if the labels could not be added. The repository was destroyed.
+ */
+int label_cache_load(const char* filename, const label_cache_stamp_t *stamp, label_repository_t* repository) {
+    filemap_t file;
+    const label_cache_header_t *header;
+    const label_entry_t *entries;
+    const char *names;
+    uint32_t i;
+    int ret = 0;
+
+    if(access(filename, R_OK)) {
+        return 0;
+    }
+    if(!filemap_open(&file, filename)) {
+        return 0;
+    }
+    if(file.len < sizeof(label_cache_header_t)) {
+        goto done;
+    }
+    header = (const label_cache_header_t*)file.data;
+    if(memcmp(header->magic, LABEL_CACHE_MAGIC, 4) || (header->version != LABEL_CACHE_VERSION) || memcmp(&header->stamp, stamp, sizeof(label_cache_stamp_t))) {
+        goto done;
+    }
+    if(file.len != (sizeof(label_cache_header_t) + ((size_t)header->count * sizeof(label_entry_t)) + header->names_size)) {
+        WARNING_MSG("Invalid label cache %s", filename);
+        goto done;
+    }
+    entries = (const label_entry_t*)(header + 1);
+    names = (const char*)(entries + header->count);
+    if(header->names_size && names[header->names_size-1]) {
+        WARNING_MSG("Invalid label cache %s", filename);
+        goto done;
+    }
+    for(i=0; i<header->count; i++) {
+        if(entries[i].name >= header->names_size) {
+            WARNING_MSG("Invalid label cache %s", filename);
+            goto done;
+        }
+    }
+    ret = label_repository_add_block(repository, entries, header->count, names, header->names_size) ? 1 : -1;
+done:
+    filemap_close(&file);
+    return ret;
+}
+
+/**
+ * Write a binary label cache file.
+ * \param [in] filename   Cache filename.
+ * \param [in] stamp      Stamp of the label file.
+ * \param [in] entries    Label entries.
+ * \param [in] count      Number of entries.
+ * \param [in] names      Label name block.
+ * \param [in] names_size Size of the label name block.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int label_cache_save(const char* filename, const label_cache_stamp_t *stamp, const label_entry_t *entries, uint32_t count, const char *names, uint32_t names_size) {
+    label_cache_header_t header;
+    FILE *out;
+    int ret;
+
+    memcpy(header.magic, LABEL_CACHE_MAGIC, 4);
+    header.version = LABEL_CACHE_VERSION;
+    header.stamp = *stamp;
+    header.count = count;
+    header.names_size = names_size;
+
+    out = fopen(filename, "wb");
+    if(out == NULL) {
+        WARNING_MSG("Failed to open %s: %s", filename, strerror(errno));
+        return 0;
+    }
+    ret = (fwrite(&header, sizeof(header), 1, out) == 1);
+    if(ret && count) {
+        ret = (fwrite(entries, sizeof(label_entry_t), count, out) == count);
+    }
+    if(ret && names_size) {
+        ret = (fwrite(names, 1, names_size, out) == names_size);
+    }
+    if(fclose(out)) {
+        ret = 0;
+    }
+    if(!ret) {
+        WARNING_MSG("Failed to write label cache %s: %s", filename, strerror(errno));
+        remove(filename);
+    }
+    return ret;
+}
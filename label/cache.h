@@ -0,0 +1,63 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_LABEL_CACHE_H
+#define ETRIPATOR_LABEL_CACHE_H
+
+#include "../label.h"
+
+/**
+ * Label file stamp.
+ * A cache is only used if it was built from a label file with the same stamp.
+ */
+typedef struct {
+    uint64_t size; /**< Label file size. **/
+    uint64_t hash; /**< FNV-1a hash of the label file content. **/
+} label_cache_stamp_t;
+
+/**
+ * Compute the stamp of a label file.
+ * \param [in]  data  Label file content.
+ * \param [in]  len   Label file size (in bytes).
+ * \param [out] stamp Label file stamp.
+ */
+void label_cache_stamp(const uint8_t *data, size_t len, label_cache_stamp_t *stamp);
+
+/**
+ * Load labels from a binary cache file.
+ * \param [in]  filename   Cache filename.
+ * \param [in]  stamp      Stamp of the label file the cache was built from.
+ * \param [out] repository Label repository.
+ * \return 1 if the labels were loaded from the cache.
+ *         0 if the cache is missing, outdated or invalid. The repository is left untouched.
+ *        -1 if the labels could not be added. The repository was destroyed.
+ */
+int label_cache_load(const char* filename, const label_cache_stamp_t *stamp, label_repository_t* repository);
+
+/**
+ * Write a binary label cache file.
+ * \param [in] filename   Cache filename.
+ * \param [in] stamp      Stamp of the label file.
+ * \param [in] entries    Label entries.
+ * \param [in] count      Number of entries.
+ * \param [in] names      Label name block.
+ * \param [in] names_size Size of the label name block.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int label_cache_save(const char* filename, const label_cache_stamp_t *stamp, const label_entry_t *entries, uint32_t count, const char *names, uint32_t names_size);
+
+#endif // ETRIPATOR_LABEL_CACHE_H
@@ -18,48 +18,90 @@
 #include <jansson.h>
 #include "../message.h"
 #include "../jsonhelpers.h"
+#include "../filemap.h"
+#include "cache.h"
 #include "load.h"
 
 #define MAX_LABEL_NAME 128
 
-/**
- * Load labels from file.
- * \param [in]  filename Input filename.
- * \param [out] repository Label repository.
- * \return 1 if the labels contained in the file were succesfully added to the repository.
- *         0 if an error occured.
- */
-int label_repository_load(const char* filename, label_repository_t* repository) {
+/* Labels read from the JSON file. They are written to the binary cache. */
+typedef struct {
+    label_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    char *names;
+    uint32_t names_size;
+    uint32_t names_capacity;
+    int failed;
+} label_cache_builder_t;
+
+static int label_cache_builder_push(label_cache_builder_t *builder, const char *name, uint16_t logical, uint8_t page) {
+    uint32_t len = (uint32_t)strlen(name) + 1;
+    if(builder->count >= builder->capacity) {
+        uint32_t capacity = builder->capacity ? (2 * builder->capacity) : 256;
+        label_entry_t *entries = (label_entry_t*)realloc(builder->entries, capacity * sizeof(label_entry_t));
+        if(entries == NULL) {
+            return 0;
+        }
+        builder->entries = entries;
+        builder->capacity = capacity;
+    }
+    if((builder->names_size + len) > builder->names_capacity) {
+        uint32_t capacity = builder->names_capacity ? builder->names_capacity : 4096;
+        char *names;
+        while((builder->names_size + len) > capacity) {
+            capacity *= 2;
+        }
+        names = (char*)realloc(builder->names, capacity);
+        if(names == NULL) {
+            return 0;
+        }
+        builder->names = names;
+        builder->names_capacity = capacity;
+    }
+    builder->entries[builder->count].name = builder->names_size;
+    builder->entries[builder->count].logical = logical;
+    builder->entries[builder->count].page = page;
+    builder->entries[builder->count].reserved = 0;
+    builder->count++;
+    memcpy(builder->names + builder->names_size, name, len);
+    builder->names_size += len;
+    return 1;
+}
+
+/* Parse JSON label file content. */
+static int label_repository_parse(const char* filename, const filemap_t *file, label_repository_t* repository, label_cache_builder_t *builder) {
     json_t* root;
     json_t* value;
     json_error_t err;
     const char* key;
-    int index;
+    size_t index;
     int num;
     uint16_t logical;
     uint8_t page;
+    int ret = 0;
 
-    root = json_load_file(filename, 0, &err);
+    root = json_loadb((const char*)file->data, file->len, 0, &err);
     if(!root) {
         ERROR_MSG("Failed to parse %s: %s", filename, err.text);
         return 0;
     }
     if(!json_is_array(root)) {
         ERROR_MSG("Array expected.");
-        return 0;
+        goto done;
     }
     
     json_array_foreach(root, index, value) {
         json_t* tmp;
         if(!json_is_object(value)) {
             ERROR_MSG("Expected object.");
-            return 0;
+            goto done;
         }
         // name
         tmp = json_object_get(value, "name");
         if (!json_is_string(tmp)) {
             ERROR_MSG("Missing or invalid label name.");
-            return 0;
+            goto done;
         }
         key = json_string_value(tmp);
 
@@ -67,30 +109,81 @@ int label_repository_load(const char* filename, label_repository_t* repository)
         tmp = json_object_get(value, "logical");
         if(!json_validate_int(tmp, &num)) {
             ERROR_MSG("Invalid or missing logical address.");
-            return 0;
+            goto done;
         }
         if((num < 0) || (num > 0xffff)) {
             ERROR_MSG("Logical address out of range.");
-            return 0;
+            goto done;
         }
         logical = (uint16_t)num;
         // page
         tmp = json_object_get(value, "page");
         if(!json_validate_int(tmp, &num)) {
             ERROR_MSG("Invalid or missing page.");
-            return 0;
+            goto done;
         }
         if((num < 0) || (num > 0xff)) {
             ERROR_MSG("Page value out of range.");
-            return 0;
+            goto done;
         }
-	    page = (uint8_t)num;
+        page = (uint8_t)num;
 
         if(!label_repository_add(repository, key, logical, page)) {
-            return 0;
+            goto done;
+        }
+        if(builder && !builder->failed && !label_cache_builder_push(builder, key, logical, page)) {
+            WARNING_MSG("Failed to allocate label cache entries.");
+            builder->failed = 1;
         }
     }
-
+    ret = 1;
+done:
     json_decref(root);
-    return 1;
+    return ret;
+}
+
+/**
+ * Load labels from file.
+ * If a cache filename is specified, the labels are read from this binary cache as long as it was
+ * built from the same label file (same size and content hash). Otherwise the JSON file is
+ * parsed and the cache is updated.
+ * \param [in]  filename       Input filename.
+ * \param [in]  cache_filename Binary label cache filename (optional).
+ * \param [out] repository     Label repository.
+ * \return 1 if the labels contained in the file were succesfully added to the repository.
+ *         0 if an error occured.
+ */
+int label_repository_load(const char* filename, const char* cache_filename, label_repository_t* repository) {
+    filemap_t file;
+    label_cache_stamp_t stamp;
+    label_cache_builder_t builder;
+    int ret;
+
+    if(!filemap_open(&file, filename)) {
+        ERROR_MSG("Failed to open %s", filename);
+        return 0;
+    }
+
+    if(cache_filename) {
+        label_cache_stamp(file.data, file.len, &stamp);
+        ret = label_cache_load(cache_filename, &stamp, repository);
+        if(ret) {
+            if(ret < 0) {
+                ERROR_MSG("Failed to add labels from %s", cache_filename);
+            }
+            filemap_close(&file);
+            return (ret > 0);
+        }
+    }
+
+    memset(&builder, 0, sizeof(builder));
+    ret = label_repository_parse(filename, &file, repository, cache_filename ? &builder : NULL);
+    if(ret && cache_filename && !builder.failed) {
+        (void)label_cache_save(cache_filename, &stamp, builder.entries, builder.count, builder.names, builder.names_size);
+    }
+    free(builder.entries);
+    free(builder.names);
+
+    filemap_close(&file);
+    return ret;
 }
@@ -22,11 +22,15 @@
 
 /**
  * Load labels from file.
- * \param [in]  filename Input filename.
- * \param [out] repository Label repository.
- * \return 1 if the labels contained in the file was succesfully added to the repository.
+ * If a cache filename is specified, the labels are read from this binary cache as long as it was
+ * built from the same label file (same size and content hash). Otherwise the JSON file is
+ * parsed and the cache is updated.
+ * \param [in]  filename       Input filename.
+ * \param [in]  cache_filename Binary label cache filename (optional).
+ * \param [out] repository     Label repository.
+ * \return 1 if the labels contained in the file were succesfully added to the repository.
  *         0 if an error occured.
  */
-int label_repository_load(const char* filename, label_repository_t* repository);
+int label_repository_load(const char* filename, const char* cache_filename, label_repository_t* repository);
 
 #endif // ETRIPATOR_LABEL_LOAD_H
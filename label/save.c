@@ -15,36 +15,68 @@
     You should have received a copy of the GNU General Public License
     along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include <errno.h>
-#include <string.h>
-
 #include "save.h"
-#include "../message.h"
+#include "../emitter.h"
 
-/**
- * Save labels to file.
- * \param [in] filename Configuration file.
- * \param [in] reposity Label repository.
- * \return 1 if the labels in the repository were succesfully written to the file.
- *         0 if an error occured.
- */
-int label_repository_save(const char* filename, label_repository_t* repository) {
-    FILE *stream = fopen(filename, "wb");
+/* Label output. */
+typedef struct {
+    label_repository_t *repository;
+    int compact;
+} label_output_t;
+
+static void label_repository_write(emitter_t *out, const void *data) {
+    /* Entry parts: before name, between name and logical, between logical and page, after page. */
+    static const char *pretty[4]  = { "\t{ \"name\":\"", "\", \"logical\":\"", "\", \"page\":\"", "\"}" };
+    static const char *minimal[4] = { "{\"name\":\"",    "\",\"logical\":\"",  "\",\"page\":\"",  "\"}" };
+    label_repository_t *repository = ((const label_output_t*)data)->repository;
+    int compact = ((const label_output_t*)data)->compact;
+    const char **part = compact ? minimal : pretty;
     int i, count = label_repository_size(repository);
-    if(stream == NULL) {
-        ERROR_MSG("Failed to open %s: %s", filename, strerror(errno));
-        return 0;
-    }
-    fprintf(stream, "[\n");
+
+    emitter_string(out, compact ? "[" : "[\n");
     for(i=0; i<count; i++) {
         uint16_t logical;
         uint8_t page;
         char* name;
         if(label_repository_get(repository, i, &logical, &page, &name)) {
-            fprintf(stream, "\t{ \"name\":\"%s\", \"logical\":\"%04x\", \"page\":\"%02x\"}%c\n", name, logical, page, (i<(count-1)) ? ',' : ' ');
+            emitter_string(out, part[0]);
+            emitter_string(out, name);
+            emitter_string(out, part[1]);
+            emitter_hex16(out, logical);
+            emitter_string(out, part[2]);
+            emitter_hex8(out, page);
+            emitter_string(out, part[3]);
+            if(!compact) {
+                emitter_string(out, (i < (count-1)) ? ",\n" : " \n");
+            }
+            else if(i < (count-1)) {
+                emitter_char(out, ',');
+            }
         }
     }
-    fprintf(stream, "]\n");
-    fclose(stream);
-    return 1;
+    emitter_string(out, "]\n");
+}
+
+/**
+ * Save labels to file.
+ * \param [in] filename Configuration file.
+ * \param [in] reposity Label repository.
+ * \return 1 if the labels in the repository were succesfully written to the file.
+ *         0 if an error occured.
+ */
+int label_repository_save(const char* filename, label_repository_t* repository) {
+    label_output_t output = { repository, 0 };
+    return emitter_save(filename, label_repository_write, &output);
+}
+
+/**
+ * Save labels to file as a single line JSON array without any whitespace.
+ * \param [in] filename Configuration file.
+ * \param [in] reposity Label repository.
+ * \return 1 if the labels in the repository were succesfully written to the file.
+ *         0 if an error occured.
+ */
+int label_repository_save_compact(const char* filename, label_repository_t* repository) {
+    label_output_t output = { repository, 1 };
+    return emitter_save(filename, label_repository_write, &output);
 }
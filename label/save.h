@@ -29,4 +29,13 @@
  */
 int label_repository_save(const char* filename, label_repository_t* repository);
 
+/**
+ * Save labels to file as a single line JSON array without any whitespace.
+ * \param [in] filename Configuration file.
+ * \param [in] reposity Label repository.
+ * \return 1 if the labels in the repository were succesfully written to the file.
+ *         0 if an error occured.
+ */
+int label_repository_save_compact(const char* filename, label_repository_t* repository);
+
 #endif // ETRIPATOR_LABEL_SAVE_H
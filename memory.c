@@ -56,3 +56,28 @@ void mem_fill(mem_t *mem, uint8_t c) {
         memset(mem->data, (int)mem->len, c);
     }
 }
+/**
+ * Grow an array so that it can hold at least the specified number of elements.
+ * \param [in out] ptr          Array pointer.
+ * \param [in out] capacity     Number of elements the array can hold.
+ * \param [in]     count        Requested number of elements.
+ * \param [in]     element_size Element size (in bytes).
+ * \return 1 upon success, 0 if an error occured.
+ */
+int mem_reserve(void **ptr, size_t *capacity, size_t count, size_t element_size) {
+    if(count > *capacity) {
+        size_t n = *capacity ? *capacity : 256;
+        void *tmp;
+        while(n < count) {
+            n *= 2;
+        }
+        tmp = realloc(*ptr, n * element_size);
+        if(tmp == NULL) {
+            ERROR_MSG("Unable to allocate memory : %s.\n", strerror(errno));
+            return 0;
+        }
+        *ptr = tmp;
+        *capacity = n;
+    }
+    return 1;
+}
@@ -44,5 +44,15 @@ void mem_destroy(mem_t *mem);
  * \param [in] c Byte value.
  */
 void mem_fill(mem_t *mem, uint8_t c);
+/**
+ * Grow an array so that it can hold at least the specified number of elements.
+ * The capacity starts at 256 elements and is doubled until it is large enough.
+ * \param [in out] ptr          Array pointer.
+ * \param [in out] capacity     Number of elements the array can hold.
+ * \param [in]     count        Requested number of elements.
+ * \param [in]     element_size Element size (in bytes).
+ * \return 1 upon success, 0 if an error occured.
+ */
+int mem_reserve(void **ptr, size_t *capacity, size_t count, size_t element_size);
 
 #endif // ETRIPATOR_MEMORY_H
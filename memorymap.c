@@ -25,6 +25,7 @@
 int memmap_init(memmap_t *map) {
     int i, ret;
     memset(map, 0, sizeof(memmap_t));
+    filemap_init(&map->rom);
     /* Allocate main (or work) RAM */
     ret = mem_create(&map->mem[PCE_MEM_BASE_RAM], 8192);
     if (!ret) {
@@ -54,7 +55,9 @@ void memmap_destroy(memmap_t *map) {
     for(i=0; i<PCE_MEM_COUNT; i++) {
         mem_destroy(&map->mem[i]);
     }
+    filemap_close(&map->rom);
     memset(map, 0, sizeof(memmap_t));
+    filemap_init(&map->rom);
 }
 /**
  * Get the memory page associated to a logical address.
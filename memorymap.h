@@ -19,6 +19,7 @@
 #define ETRIPATOR_MEMORY_MAP_H
 
 #include "memory.h"
+#include "filemap.h"
 
 /**
  * PC Engine memory 
@@ -36,7 +37,11 @@ enum {
  */
 typedef struct {
     mem_t mem[PCE_MEM_COUNT];
+    filemap_t rom;    /**< ROM file mapping. ROM pages point into it. **/
+    const filemap_t *cd; /**< CDROM image mapping. Set when CDROM pages point into it. **/
     uint8_t *page[0x100];
+    uint8_t *store[0x100]; /**< Page storage. Set for pages that were pointed to a CDROM image. **/
+    uint8_t rewritten[0x100]; /**< Set for pages whose storage was overwritten with data read from another file offset. **/
     uint8_t mpr[8];
 } memmap_t;
 
@@ -65,6 +70,22 @@ uint8_t memmap_page(memmap_t* map, uint16_t logical);
  * \return Byte read.
  */
 uint8_t memmap_read(memmap_t *map, size_t logical);
+/**
+ * Retrieve a direct pointer to the memory mapped at the specified logical address.
+ * The span never crosses the 8KB page containing the logical address.
+ * \param [in]     map     Memory map.
+ * \param [in]     logical Logical address.
+ * \param [in,out] len     Number of bytes requested. On return, number of contiguous bytes available.
+ * \return Pointer to the first byte, or NULL if the page is not mapped (in which case bytes read as 0xff).
+ */
+static inline const uint8_t* memmap_span(memmap_t *map, uint16_t logical, size_t *len) {
+    uint8_t i = map->mpr[(logical >> 13) & 0x07];
+    size_t offset = logical & 0x1fff;
+    if(*len > (0x2000 - offset)) {
+        *len = 0x2000 - offset;
+    }
+    return map->page[i] ? (map->page[i] + offset) : NULL;
+}
 /**
  * Update mprs.
  * \param [in][out] map Memory map.
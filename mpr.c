@@ -0,0 +1,212 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "mpr.h"
+#include "message.h"
+#include "memory.h"
+
+/* Accumulator followed by the 8 memory page registers. */
+#define MPR_STATE_SIZE 9
+/* Value is not known. */
+#define MPR_UNKNOWN (-1)
+/* Instruction was not reached yet (stored in the accumulator slot). */
+#define MPR_UNVISITED (-2)
+
+#define MPR_NAME(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
+
+/* Tells if the instruction overwrites the accumulator with an unknown value. */
+static int mpr_clobbers_accumulator(const opcode_t *opcode) {
+    if(opcode->type == PCE_OP_A) {
+        return 1;
+    }
+    switch(MPR_NAME(opcode->name[0], opcode->name[1], opcode->name[2])) {
+        case MPR_NAME('l','d','a'):
+        case MPR_NAME('a','d','c'):
+        case MPR_NAME('s','b','c'):
+        case MPR_NAME('a','n','d'):
+        case MPR_NAME('o','r','a'):
+        case MPR_NAME('e','o','r'):
+        case MPR_NAME('p','l','a'):
+        case MPR_NAME('t','x','a'):
+        case MPR_NAME('t','y','a'):
+        case MPR_NAME('s','a','x'):
+        case MPR_NAME('s','a','y'):
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Updates the state with the effect of an instruction. */
+static void mpr_transfer(int16_t *state, const insn_t *insn) {
+    uint8_t inst = insn->data[0];
+    int i;
+    switch(inst) {
+        case 0xa9: /* LDA #nn */
+            state[0] = insn->data[1];
+            break;
+        case 0x62: /* CLA */
+            state[0] = 0;
+            break;
+        case 0x53: /* TAM #nn */
+            for(i=0; i<8; i++) {
+                if(insn->data[1] & (1 << i)) {
+                    state[1+i] = state[0];
+                }
+            }
+            break;
+        case 0x43: /* TMA #nn */
+            state[0] = MPR_UNKNOWN;
+            for(i=0; i<8; i++) {
+                if(insn->data[1] == (1 << i)) {
+                    state[0] = state[1+i];
+                }
+            }
+            break;
+        case 0x20: /* JSR */
+        case 0x44: /* BSR */
+            /* Subroutines are expected to restore the memory page registers they modify. */
+            state[0] = MPR_UNKNOWN;
+            break;
+        default:
+            if(mpr_clobbers_accumulator(opcode_get(inst))) {
+                state[0] = MPR_UNKNOWN;
+            }
+            break;
+    }
+}
+
+/* Merges a state into the state of an instruction. Returns 1 if the latter changed. */
+static int mpr_merge(int16_t *dst, const int16_t *src) {
+    int i, changed = 0;
+    if(dst[0] == MPR_UNVISITED) {
+        memcpy(dst, src, MPR_STATE_SIZE * sizeof(int16_t));
+        return 1;
+    }
+    for(i=0; i<MPR_STATE_SIZE; i++) {
+        if((dst[i] != src[i]) && (dst[i] != MPR_UNKNOWN)) {
+            dst[i] = MPR_UNKNOWN;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+/* Propagates the state of an instruction to one of its successors. */
+static int mpr_visit(mpr_tracker_t *tracker, size_t *count, int32_t j, const int16_t *state) {
+    if((j < 0) || !mpr_merge(&tracker->state[j * MPR_STATE_SIZE], state)) {
+        return 1;
+    }
+    if(!mem_reserve((void**)&tracker->work, &tracker->work_capacity, *count + 1, sizeof(uint32_t))) {
+        return 0;
+    }
+    tracker->work[(*count)++] = (uint32_t)j;
+    return 1;
+}
+
+/* Initializes memory page register tracker. */
+void mpr_tracker_init(mpr_tracker_t *tracker) {
+    memset(tracker, 0, sizeof(mpr_tracker_t));
+}
+
+/* Releases memory page register tracker resources. */
+void mpr_tracker_destroy(mpr_tracker_t *tracker) {
+    free(tracker->state);
+    insn_index_destroy(&tracker->index);
+    free(tracker->work);
+    memset(tracker, 0, sizeof(mpr_tracker_t));
+}
+
+/* Propagates memory page register values and updates far jump targets. */
+int mpr_propagate(mpr_tracker_t *tracker, const section_t *section, insn_list_t *list) {
+    int16_t state[MPR_STATE_SIZE];
+    size_t i, count;
+    int updated = 0;
+
+    if((list->count == 0) || (section->size <= 0)) {
+        return 0;
+    }
+    if(!mem_reserve((void**)&tracker->state, &tracker->state_capacity, list->count * MPR_STATE_SIZE, sizeof(int16_t))
+    || !insn_index_build(&tracker->index, section, list)) {
+        return -1;
+    }
+
+    for(i=0; i<list->count; i++) {
+        tracker->state[i * MPR_STATE_SIZE] = MPR_UNVISITED;
+    }
+
+    /* The section entry point starts with the section memory page registers. */
+    state[0] = MPR_UNKNOWN;
+    for(i=0; i<8; i++) {
+        state[1+i] = section->mpr[i];
+    }
+    count = 0;
+    if(!mpr_visit(tracker, &count, 0, state)) {
+        return -1;
+    }
+
+    while(count) {
+        uint32_t j = tracker->work[--count];
+        const insn_t *insn = &list->insn[j];
+        uint8_t inst = insn->data[0];
+        int32_t next = ((j+1) < list->count) ? insn_index_find(&tracker->index, insn->logical + insn->size) : -1;
+
+        memcpy(state, &tracker->state[j * MPR_STATE_SIZE], sizeof(state));
+        mpr_transfer(state, insn);
+
+        switch(inst) {
+            case 0x00: /* BRK */
+            case 0x40: /* RTI */
+            case 0x60: /* RTS */
+            case 0x6c: /* JMP (hhll) */
+            case 0x7c: /* JMP (hhll, X) */
+                next = -1;
+                break;
+            case 0x4c: /* JMP hhll */
+            case 0x80: /* BRA */
+                next = insn_index_find(&tracker->index, insn->target);
+                break;
+            default:
+                if(opcode_is_local_jump(inst) && (inst != 0x44)) {
+                    if(!mpr_visit(tracker, &count, insn_index_find(&tracker->index, insn->target), state)) {
+                        return -1;
+                    }
+                }
+                break;
+        }
+        if(!mpr_visit(tracker, &count, next, state)) {
+            return -1;
+        }
+    }
+
+    /* Resolve far jump target pages. */
+    for(i=0; i<list->count; i++) {
+        insn_t *insn = &list->insn[i];
+        const int16_t *current = &tracker->state[i * MPR_STATE_SIZE];
+        int16_t page;
+        if(((insn->data[0] != 0x20) && (insn->data[0] != 0x4c)) || (current[0] == MPR_UNVISITED)) {
+            continue;
+        }
+        page = current[1 + (insn->target >> 13)];
+        if((page != MPR_UNKNOWN) && (page != insn->target_page)) {
+            INFO_MSG("%04x far jump target %04x resolved to page %02x (was %02x)", insn->logical, insn->target, page, insn->target_page);
+            insn->target_page = (uint8_t)page;
+            updated++;
+        }
+    }
+    return updated;
+}
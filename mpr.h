@@ -0,0 +1,61 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_MPR_H
+#define ETRIPATOR_MPR_H
+
+#include "config.h"
+#include "decode.h"
+#include "decode/index.h"
+
+/**
+ * Memory page register tracking state.
+ */
+typedef struct {
+    int16_t *state;          /**< Accumulator and memory page register values before each instruction (scratch). **/
+    size_t state_capacity;
+    insn_index_t index;      /**< Instruction index of each section byte (scratch). **/
+    uint32_t *work;          /**< Instructions to visit (scratch). **/
+    size_t work_capacity;
+} mpr_tracker_t;
+
+/**
+ * Initializes memory page register tracker.
+ * \param [out] tracker Memory page register tracker.
+ */
+void mpr_tracker_init(mpr_tracker_t *tracker);
+
+/**
+ * Releases memory page register tracker resources.
+ * \param [in,out] tracker Memory page register tracker.
+ */
+void mpr_tracker_destroy(mpr_tracker_t *tracker);
+
+/**
+ * Propagates the memory page register values along the control flow of a code section, and
+ * updates the page of the far jump (jmp, jsr) targets accordingly.
+ * The section entry point starts with the section memory page registers. Values are set by
+ * `tam` from an accumulator loaded with an immediate value (`lda #nn`, `cla` or `tma`).
+ * Subroutine calls are assumed to preserve the memory page registers.
+ * \param [in,out] tracker Memory page register tracker.
+ * \param [in]     section Code section.
+ * \param [in,out] list    Section instructions.
+ * \return Number of jump targets whose page was updated, or -1 if an error occured.
+ */
+int mpr_propagate(mpr_tracker_t *tracker, const section_t *section, insn_list_t *list);
+
+#endif // ETRIPATOR_MPR_H
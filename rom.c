@@ -20,82 +20,74 @@
 
 /**
  * Load ROM from file.
+ * The ROM file is mapped into memory and the memory map pages point
+ * directly into it. Only the trailing partial bank is copied into a
+ * 0xff padded buffer.
  * \param [in]  filename ROM filename.
  * \param [out] memmap   Memory map.
  * \return 1 upon success, 0 if an error occured.
  */
 int rom_load(const char* filename, memmap_t* map) {
-    FILE   *in;
-    int i;
-    size_t size;
-    size_t count, nread;
-    /* Open file */
-    in = fopen(filename, "rb");
-    if(!in) {
-        ERROR_MSG("Unable to open %s : %s", filename, strerror(errno));
+    uint8_t *bank[128];
+    size_t size, offset, count;
+    size_t full, i;
+    /* Map file */
+    if(!filemap_open(&map->rom, filename)) {
         return 0;
     }
-    /* Compute file size. */
-    fseek(in, 0, SEEK_END);
-    size  = ftell(in);
-    fseek(in, 0, SEEK_SET);
-    size -= ftell(in);
-    /* Check size */
-    if(!size) {
-        ERROR_MSG("Empty file: %s", filename);
-        goto err_0;
-    }
+    size = map->rom.len;
+    offset = 0;
     /* Check for possible header */
     if(size & 0x200) {
         /* Jump header */
         size &= ~0x200;
-        if(fseek(in, 0x200, SEEK_SET)) {
-            ERROR_MSG("Failed to jump rom header in %s: %s", filename, strerror(errno));
-            goto err_0;
-        }
+        offset = 0x200;
     }
-    /* Allocate rom storage */
-    if(!mem_create(&map->mem[PCE_MEM_ROM], (size + 0x1fff) & ~0x1fff)) {
-        ERROR_MSG("Failed to allocate ROM storage : %s", strerror(errno));
+    /* Check size */
+    if(!size) {
+        ERROR_MSG("Empty file: %s", filename);
         goto err_0;
     }
-    /* Fill rom with 0xff */
-    memset(map->mem[PCE_MEM_ROM].data, 0xff, map->mem[PCE_MEM_ROM].len);
-    /* Read ROM data */
-    count = (size < map->mem[PCE_MEM_ROM].len) ? size : map->mem[PCE_MEM_ROM].len;
-    nread = fread(map->mem[PCE_MEM_ROM].data, 1, count, in);
-    if(nread != count) {
-        ERROR_MSG("Failed to read ROM data from %s : %s", filename, strerror(errno));
-        goto err_1;
+    /* Full banks are used in place. */
+    full = size / 8192;
+    count = (size + 0x1fff) / 8192;
+    for(i=0; (i<full) && (i<128); i++) {
+        bank[i] = map->rom.data + offset + (i * 8192);
+    }
+    /* The trailing partial bank is padded with 0xff. */
+    if((full < count) && (full < 128)) {
+        if(!mem_create(&map->mem[PCE_MEM_ROM], 8192)) {
+            ERROR_MSG("Failed to allocate ROM storage : %s", strerror(errno));
+            goto err_0;
+        }
+        memset(map->mem[PCE_MEM_ROM].data, 0xff, 8192);
+        memcpy(map->mem[PCE_MEM_ROM].data, map->rom.data + offset + (full * 8192), size - (full * 8192));
+        bank[full] = map->mem[PCE_MEM_ROM].data;
     }
-    fclose(in);
     /* Initialize ROM pages. */
-    if(map->mem[PCE_MEM_ROM].len == 0x60000) {
+    if(count == 0x30) {
         for(i=0; i<64; i++) {
-            map->page[i] = &map->mem[PCE_MEM_ROM].data[(i & 0x1f) * 8192];
+            map->page[i] = bank[i & 0x1f];
         }
         for(i=64; i<128; i++) {
-            map->page[i] = &map->mem[PCE_MEM_ROM].data[((i & 0x0f) + 32) * 8192];
+            map->page[i] = bank[(i & 0x0f) + 32];
         }
     }
-    else if(map->mem[PCE_MEM_ROM].len == 0x80000) {
+    else if(count == 0x40) {
         for(i=0; i<64; i++) {
-            map->page[i] = &map->mem[PCE_MEM_ROM].data[(i & 0x3f) * 8192];
+            map->page[i] = bank[i & 0x3f];
         }
         for(i=64; i<128; i++) {
-            map->page[i] = &map->mem[PCE_MEM_ROM].data[((i & 0x1f) + 32) * 8192];
+            map->page[i] = bank[(i & 0x1f) + 32];
         }
     }
     else {
         for(i=0; i<128; i++) {
-            uint8_t bank = (uint8_t)(i % (map->mem[PCE_MEM_ROM].len / 8192));
-            map->page[i] = &map->mem[PCE_MEM_ROM].data[bank * 8192];
+            map->page[i] = bank[(uint8_t)(i % count)];
         }
     }
     return 1;
-err_1:
-    mem_destroy(&map->mem[PCE_MEM_ROM]);
 err_0:
-    fclose(in);
+    filemap_close(&map->rom);
     return 0;
 }
@@ -42,6 +42,9 @@ int section_save(const char *filename, section_t *ptr, int n) {
     fprintf(out, "{\n");
     for(i=0; i<n; i++) {
         int j;
+        if(i) {
+            fprintf(out, ",\n");
+        }
         fprintf(out, "    \"%s\": {\n", ptr[i].name);
         fprintf(out, "        \"type\": \"%s\",\n", section_type_name(ptr[i].type));
         fprintf(out, "        \"page\": \"%02x\",\n", ptr[i].page);
@@ -50,10 +53,10 @@ int section_save(const char *filename, section_t *ptr, int n) {
         fprintf(out, "        \"size\": %d,\n", ptr[i].size);
         fprintf(out, "        \"mpr\": [");
         for(j=0; j<8; j++) {
-            fprintf(out, "\"%02x\"%x", ptr[i].mpr[j], (j<7) ? ',' : ']');
+            fprintf(out, "\"%02x\"%c", ptr[i].mpr[j], (j<7) ? ',' : ']');
         }
-        fprintf(out, "\n");
-        fprintf(out, "        \"output\": \"%s\"", ptr[i].output);
+        fprintf(out, ",\n");
+        fprintf(out, "        \"filename\": \"%s\"", ptr[i].output);
         if(ptr[i].type == Data) {
             fprintf(out, ",\n        \"data\": {\n");
             fprintf(out, "               \"type\": \"%s\",\n", data_type_name(ptr[i].data.type));
@@ -61,9 +64,9 @@ int section_save(const char *filename, section_t *ptr, int n) {
             fprintf(out, "               \"elements_per_line\": %d\n", ptr[i].data.elements_per_line);
             fprintf(out, "            }\n");
         }
-        fprintf(out, "\n}\n");
+        fprintf(out, "\n    }");
     }
-    fprintf(out, "}\n");
+    fprintf(out, "\n}\n");
     
     fclose(out);
     return 1;
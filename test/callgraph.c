@@ -0,0 +1,110 @@
+#include <munit.h>
+#include "callgraph.h"
+#include "insn.h"
+#include "message.h"
+#include "message/console.h"
+#include "message/file.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+MunitResult callgraph_csr_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    static const uint8_t jsr_c100[] = { 0x20, 0x00, 0xc1 };
+    static const uint8_t jsr_c200[] = { 0x20, 0x00, 0xc2 };
+    static const uint8_t bsr[] = { 0x44, 0xfb };
+    static const uint8_t rts[] = { 0x60 };
+
+    int ret;
+    insn_list_t list;
+    callgraph_t graph;
+
+    callgraph_init(&graph);
+    memset(&list, 0, sizeof(insn_list_t));
+
+    /* main calls sub_c100 twice and sub_c200 once. */
+    insn_push(&list, 0xc000, 0x00, jsr_c100, 3, 0xc100, 0x00);
+    insn_push(&list, 0xc003, 0x00, jsr_c100, 3, 0xc100, 0x00);
+    insn_push(&list, 0xc006, 0x00, jsr_c200, 3, 0xc200, 0x00);
+    insn_push(&list, 0xc009, 0x00, bsr, 2, 0xc006, 0x00);
+    insn_push(&list, 0xc00b, 0x00, rts, 1, 0, 0);
+    ret = callgraph_add(&graph, &list);
+    munit_assert_int(ret, !=, 0);
+
+    /* sub_c100 calls sub_c200. */
+    list.count = 0;
+    insn_push(&list, 0xc100, 0x00, jsr_c200, 3, 0xc200, 0x00);
+    insn_push(&list, 0xc103, 0x00, rts, 1, 0, 0);
+    ret = callgraph_add(&graph, &list);
+    munit_assert_int(ret, !=, 0);
+
+    munit_assert_size(graph.site_count, ==, 4);
+
+    ret = callgraph_build(&graph);
+    munit_assert_int(ret, !=, 0);
+
+    munit_assert_size(graph.node_count, ==, 3);
+    munit_assert_uint32(graph.node[0], ==, callgraph_address(0xc000, 0x00));
+    munit_assert_uint32(graph.node[1], ==, callgraph_address(0xc100, 0x00));
+    munit_assert_uint32(graph.node[2], ==, callgraph_address(0xc200, 0x00));
+
+    munit_assert_size(graph.edge_count, ==, 3);
+    munit_assert_uint32(graph.row[0], ==, 0);
+    munit_assert_uint32(graph.row[1], ==, 2);
+    munit_assert_uint32(graph.row[2], ==, 3);
+    munit_assert_uint32(graph.row[3], ==, 3);
+
+    munit_assert_uint32(graph.column[0], ==, 1);
+    munit_assert_uint32(graph.weight[0], ==, 2);
+    munit_assert_uint32(graph.column[1], ==, 2);
+    munit_assert_uint32(graph.weight[1], ==, 1);
+    munit_assert_uint32(graph.column[2], ==, 2);
+    munit_assert_uint32(graph.weight[2], ==, 1);
+
+    munit_assert_uint32(graph.calls[0], ==, 0);
+    munit_assert_uint32(graph.calls[1], ==, 2);
+    munit_assert_uint32(graph.calls[2], ==, 2);
+    munit_assert_uint32(graph.callers[0], ==, 0);
+    munit_assert_uint32(graph.callers[1], ==, 1);
+    munit_assert_uint32(graph.callers[2], ==, 2);
+
+    /* The graph can be rebuilt. */
+    ret = callgraph_build(&graph);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_size(graph.node_count, ==, 3);
+    munit_assert_size(graph.edge_count, ==, 3);
+
+    callgraph_destroy(&graph);
+    free(list.insn);
+    return MUNIT_OK;
+}
+
+static MunitTest callgraph_tests[] = {
+    { "/csr", callgraph_csr_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite callgraph_suite = {
+    "Call graph test suite", callgraph_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&callgraph_suite, NULL, argc, argv);
+}
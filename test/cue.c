@@ -0,0 +1,200 @@
+#include <munit.h>
+#include "cd/cue.h"
+#include "message.h"
+#include "message/console.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+static void cue_write(const char *filename, const char *text) {
+    FILE *out = fopen(filename, "wb");
+    munit_assert_not_null(out);
+    munit_assert_size(fwrite(text, 1, strlen(text), out), ==, strlen(text));
+    fclose(out);
+}
+
+/* Writes an image made of raw sectors with the specified mode byte. */
+static void raw_write(const char *filename, int sector_count, uint8_t mode) {
+    static const uint8_t sync[12] = {
+        0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00
+    };
+    uint8_t sector[2352];
+    FILE *out = fopen(filename, "wb");
+    int i;
+    munit_assert_not_null(out);
+    for(i=0; i<sector_count; i++) {
+        memset(sector, 0, sizeof(sector));
+        memcpy(sector, sync, sizeof(sync));
+        sector[15] = mode;
+        munit_assert_size(fwrite(sector, 1, sizeof(sector), out), ==, sizeof(sector));
+    }
+    fclose(out);
+}
+
+MunitResult cue_msf_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    char *image = NULL;
+    cd_track_t track;
+    int ret;
+
+    cue_write("cue_msf.cue",
+        "REM single data track\n"
+        "FILE \"image.iso\" BINARY\n"
+        "  TRACK 01 MODE1/2048\n"
+        "    INDEX 01 01:02:03\n");
+    ret = cd_track_find("cue_msf.cue", &image, &track);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_string_equal(image, "image.iso");
+    munit_assert_size(track.offset, ==, (((1 * 60) + 2) * 75 + 3) * 2048);
+    munit_assert_size(track.sector_size, ==, 2048);
+    munit_assert_size(track.header_size, ==, 0);
+    free(image);
+
+    remove("cue_msf.cue");
+    return MUNIT_OK;
+}
+
+MunitResult cue_raw_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    char *image = NULL;
+    cd_track_t track;
+    int ret;
+
+    /* Raw image without cue sheet. */
+    raw_write("cue_raw.bin", 4, 1);
+    ret = cd_track_find("cue_raw.bin", &image, &track);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_string_equal(image, "cue_raw.bin");
+    munit_assert_size(track.offset, ==, 0);
+    munit_assert_size(track.sector_size, ==, 2352);
+    munit_assert_size(track.header_size, ==, 16);
+    munit_assert_size(cd_track_offset(&track, 2048 + 5), ==, 2352 + 16 + 5);
+    free(image);
+
+    /* Raw data track from a cue sheet. */
+    cue_write("cue_raw.cue",
+        "FILE \"cue_raw.bin\" BINARY\n"
+        "  TRACK 01 MODE1/2352\n"
+        "    INDEX 01 00:00:02\n");
+    ret = cd_track_find("cue_raw.cue", &image, &track);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_string_equal(image, "cue_raw.bin");
+    munit_assert_size(track.offset, ==, 2 * 2352);
+    munit_assert_size(track.sector_size, ==, 2352);
+    munit_assert_size(track.header_size, ==, 16);
+    free(image);
+
+    /* Mode 2 sectors are rejected. */
+    raw_write("cue_raw.bin", 4, 2);
+    image = NULL;
+    ret = cd_track_find("cue_raw.bin", &image, &track);
+    munit_assert_int(ret, ==, 0);
+    munit_assert_null(image);
+
+    remove("cue_raw.cue");
+    remove("cue_raw.bin");
+    return MUNIT_OK;
+}
+
+MunitResult cue_multi_track_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    char *image = NULL;
+    cd_track_t track;
+    int ret;
+
+    /* The data track follows an audio track in the same file. */
+    cue_write("cue_multi.cue",
+        "FILE \"disc.bin\" BINARY\n"
+        "  TRACK 01 AUDIO\n"
+        "    INDEX 01 00:00:00\n"
+        "  TRACK 02 MODE1/2048\n"
+        "    INDEX 00 00:10:00\n"
+        "    INDEX 01 00:12:00\n"
+        "  TRACK 03 MODE1/2048\n"
+        "    INDEX 01 00:20:00\n");
+    ret = cd_track_find("cue_multi.cue", &image, &track);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_string_equal(image, "disc.bin");
+    munit_assert_size(track.offset, ==, (10 * 75 * 2352) + (2 * 75 * 2048));
+    munit_assert_size(track.sector_size, ==, 2048);
+    free(image);
+
+    /* One file per track. */
+    cue_write("cue_multi.cue",
+        "FILE \"track01.bin\" BINARY\n"
+        "  TRACK 01 AUDIO\n"
+        "    INDEX 01 00:00:00\n"
+        "FILE \"track02.bin\" BINARY\n"
+        "  TRACK 02 MODE1/2352\n"
+        "    INDEX 00 00:00:00\n"
+        "    INDEX 01 00:02:00\n");
+    ret = cd_track_find("cue_multi.cue", &image, &track);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_string_equal(image, "track02.bin");
+    munit_assert_size(track.offset, ==, 2 * 75 * 2352);
+    munit_assert_size(track.sector_size, ==, 2352);
+    munit_assert_size(track.header_size, ==, 16);
+    free(image);
+
+    /* The first data track is not a mode 1 track. */
+    cue_write("cue_multi.cue",
+        "FILE \"disc.bin\" BINARY\n"
+        "  TRACK 01 AUDIO\n"
+        "    INDEX 01 00:00:00\n"
+        "  TRACK 02 MODE2/2352\n"
+        "    INDEX 01 00:10:00\n"
+        "  TRACK 03 MODE1/2352\n"
+        "    INDEX 01 00:20:00\n");
+    image = NULL;
+    ret = cd_track_find("cue_multi.cue", &image, &track);
+    munit_assert_int(ret, ==, 0);
+    munit_assert_null(image);
+
+    /* Audio only. */
+    cue_write("cue_multi.cue",
+        "FILE \"disc.bin\" BINARY\n"
+        "  TRACK 01 AUDIO\n"
+        "    INDEX 01 00:00:00\n");
+    ret = cd_track_find("cue_multi.cue", &image, &track);
+    munit_assert_int(ret, ==, 0);
+    munit_assert_null(image);
+
+    remove("cue_multi.cue");
+    return MUNIT_OK;
+}
+
+static MunitTest cue_tests[] = {
+    { "/msf", cue_msf_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/raw", cue_raw_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/multi_track", cue_multi_track_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite cue_suite = {
+    "Cue sheet test suite", cue_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&cue_suite, NULL, argc, argv);
+}
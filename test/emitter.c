@@ -0,0 +1,149 @@
+#include <munit.h>
+#include "emitter.h"
+#include "message.h"
+#include "message/console.h"
+
+/* Source bytes. Every byte value is present at every alignment. */
+#define EMITTER_TEST_SOURCE_SIZE 512
+#define EMITTER_TEST_MAX_LENGTH 100
+#define EMITTER_TEST_SENTINEL '#'
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+/* The AVX2 build is skipped on processors without AVX2. */
+static int emitter_test_supported(void) {
+#if defined(__AVX2__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return 1;
+#endif
+}
+
+/* Scalar conversion of bytes to a "$xx" list. */
+static size_t emitter_test_hex_list(char *dst, const uint8_t *src, size_t count) {
+    static const char hex[] = "0123456789abcdef";
+    size_t i, n = 0;
+    for(i=0; i<count; i++) {
+        if(i) {
+            dst[n++] = ',';
+        }
+        dst[n++] = '$';
+        dst[n++] = hex[src[i] >> 4];
+        dst[n++] = hex[src[i] & 0x0f];
+    }
+    return n;
+}
+
+/* Scalar count of the leading printable characters. */
+static size_t emitter_test_printable_length(const uint8_t *src, size_t len) {
+    size_t i;
+    for(i=0; (i<len) && (src[i] >= 0x20) && (src[i] < 0x7f); i++) {
+    }
+    return i;
+}
+
+MunitResult emitter_hex_list_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    uint8_t src[EMITTER_TEST_SOURCE_SIZE];
+    char expected[4 * EMITTER_TEST_MAX_LENGTH];
+    emitter_t emitter;
+    size_t start, count, len;
+
+    if(!emitter_test_supported()) {
+        return MUNIT_SKIP;
+    }
+    for(start=0; start<EMITTER_TEST_SOURCE_SIZE; start++) {
+        src[start] = (uint8_t)start;
+    }
+    munit_assert_int(emitter_init(&emitter), !=, 0);
+    emitter_reset(&emitter, NULL);
+
+    /* Unaligned starts cover every byte value in every lane of a block. */
+    for(start=0; start<256; start++) {
+        for(count=0; count<=EMITTER_TEST_MAX_LENGTH; count++) {
+            memset(emitter.buffer, EMITTER_TEST_SENTINEL, 4 * (EMITTER_TEST_MAX_LENGTH + 1));
+            emitter.size = 0;
+            emitter_hex_list(&emitter, src + start, count, 1);
+            len = emitter_test_hex_list(expected, src + start, count);
+            munit_assert_size(emitter.size, ==, len);
+            munit_assert_memory_equal(len, emitter.buffer, expected);
+            /* Only the trailing comma may be written past the list. */
+            munit_assert_int(emitter.buffer[count ? (len + 1) : 0], ==, EMITTER_TEST_SENTINEL);
+        }
+    }
+
+    emitter_destroy(&emitter);
+    return MUNIT_OK;
+}
+
+MunitResult emitter_printable_length_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    uint8_t src[EMITTER_TEST_SOURCE_SIZE];
+    size_t start, len, pos;
+    unsigned int value;
+
+    if(!emitter_test_supported()) {
+        return MUNIT_SKIP;
+    }
+
+    /* Every byte value at every position of a printable string, with unaligned starts. */
+    for(value=0; value<256; value++) {
+        for(len=0; len<=EMITTER_TEST_MAX_LENGTH; len++) {
+            for(pos=0; pos<len; pos++) {
+                uint8_t *str;
+                start = (value + pos) % 32;
+                str = src + start;
+                memset(str, 'a', len);
+                str[pos] = (uint8_t)value;
+                munit_assert_size(emitter_printable_length(str, len), ==, emitter_test_printable_length(str, len));
+            }
+        }
+    }
+
+    /* Byte sequences. */
+    for(start=0; start<256; start++) {
+        src[start] = (uint8_t)start;
+        src[start + 256] = (uint8_t)start;
+    }
+    for(start=0; start<256; start++) {
+        for(len=0; len<=EMITTER_TEST_MAX_LENGTH; len++) {
+            munit_assert_size(emitter_printable_length(src + start, len), ==, emitter_test_printable_length(src + start, len));
+        }
+    }
+    return MUNIT_OK;
+}
+
+static MunitTest emitter_tests[] = {
+    { "/hex_list", emitter_hex_list_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/printable_length", emitter_printable_length_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite emitter_suite = {
+    "Emitter test suite", emitter_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&emitter_suite, NULL, argc, argv);
+}
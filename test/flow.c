@@ -0,0 +1,112 @@
+#include <munit.h>
+#include "flow.h"
+#include "insn.h"
+#include "message.h"
+#include "message/console.h"
+#include "message/file.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+MunitResult flow_block_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    static const uint8_t jsr_d000[] = { 0x20, 0x00, 0xd0 };
+    static const uint8_t rts[] = { 0x60 };
+    static const uint8_t jmp_e000[] = { 0x4c, 0x00, 0xe0 };
+
+    section_t code = { "code", Code, 0x00, 0xc000, 0x0000, 0x0e, { 0xff, 0xf8, 0, 0, 0, 0, 0, 0 }, "code.asm", { Binary, 0, 0 } };
+    section_t tail = { "tail", Code, 0x00, 0xc100, 0x0100, 0x03, { 0xff, 0xf8, 0, 0, 0, 0, 0, 0 }, "code.asm", { Binary, 0, 0 } };
+
+    int ret;
+    insn_list_t list;
+    flow_graph_t graph;
+    const flow_block_t *block;
+    const flow_edge_t *edge;
+
+    memset(&list, 0, sizeof(insn_list_t));
+    insn_push_branch(&list);
+    insn_push(&list, 0xc00a, 0x00, jsr_d000, 3, 0xd000, 0x00);
+    insn_push(&list, 0xc00d, 0x00, rts, 1, 0, 0);
+
+    flow_graph_init(&graph);
+    ret = flow_graph_add(&graph, &code, 0, &list);
+    munit_assert_int(ret, !=, 0);
+
+    /* The branch ends the first block, and its target starts the third one. The subroutine call does not end a block. */
+    munit_assert_size(graph.block_count, ==, 3);
+    block = &graph.block[0];
+    munit_assert_uint16(block->logical, ==, 0xc000);
+    munit_assert_uint16(block->size, ==, 6);
+    munit_assert_uint32(block->insn_count, ==, 3);
+    munit_assert_uint32(block->edge_count, ==, 2);
+    block = &graph.block[1];
+    munit_assert_uint16(block->logical, ==, 0xc006);
+    munit_assert_uint16(block->size, ==, 4);
+    munit_assert_uint32(block->insn_count, ==, 2);
+    munit_assert_uint32(block->edge_count, ==, 1);
+    block = &graph.block[2];
+    munit_assert_uint16(block->logical, ==, 0xc00a);
+    munit_assert_uint16(block->size, ==, 4);
+    munit_assert_uint32(block->insn_count, ==, 2);
+    munit_assert_uint32(block->edge_count, ==, 0);
+
+    munit_assert_size(graph.edge_count, ==, 3);
+    edge = &graph.edge[graph.block[0].edge];
+    munit_assert_uint8(edge[0].kind, ==, FlowBranch);
+    munit_assert_uint32(edge[0].block, ==, 2);
+    munit_assert_uint8(edge[1].kind, ==, FlowFallthrough);
+    munit_assert_uint32(edge[1].block, ==, 1);
+    edge = &graph.edge[graph.block[1].edge];
+    munit_assert_uint8(edge[0].kind, ==, FlowFallthrough);
+    munit_assert_uint32(edge[0].block, ==, 2);
+
+    /* Jumps outside of the section are not resolved to a block. */
+    list.count = 0;
+    insn_push(&list, 0xc100, 0x00, jmp_e000, 3, 0xe000, 0x00);
+    ret = flow_graph_add(&graph, &tail, 1, &list);
+    munit_assert_int(ret, !=, 0);
+
+    munit_assert_size(graph.block_count, ==, 4);
+    block = &graph.block[3];
+    munit_assert_int(block->section, ==, 1);
+    munit_assert_uint16(block->logical, ==, 0xc100);
+    munit_assert_uint32(block->edge_count, ==, 1);
+    edge = &graph.edge[block->edge];
+    munit_assert_uint8(edge->kind, ==, FlowJump);
+    munit_assert_uint32(edge->block, ==, FLOW_EXTERNAL);
+    munit_assert_uint16(edge->logical, ==, 0xe000);
+
+    flow_graph_destroy(&graph);
+    free(list.insn);
+    return MUNIT_OK;
+}
+
+static MunitTest flow_tests[] = {
+    { "/block", flow_block_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite flow_suite = {
+    "Control flow graph test suite", flow_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&flow_suite, NULL, argc, argv);
+}
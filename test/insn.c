@@ -0,0 +1,32 @@
+#include <munit.h>
+#include "insn.h"
+#include "memory.h"
+
+/* Appends an instruction to the list. */
+void insn_push(insn_list_t *list, uint16_t logical, uint8_t page, const uint8_t *data, uint8_t size, uint16_t target, uint8_t target_page) {
+    insn_t *insn;
+    munit_assert_int(mem_reserve((void**)&list->insn, &list->capacity, list->count + 1, sizeof(insn_t)), !=, 0);
+    insn = &list->insn[list->count++];
+    memset(insn, 0, sizeof(insn_t));
+    insn->logical = logical;
+    insn->page = page;
+    insn->size = size;
+    memcpy(insn->data, data, size);
+    insn->target = target;
+    insn->target_page = target_page;
+}
+
+/* Appends the instructions of a branch skipping a memory page register update. */
+void insn_push_branch(insn_list_t *list) {
+    static const uint8_t lda_20[] = { 0xa9, 0x20 };
+    static const uint8_t tam_20[] = { 0x53, 0x20 };
+    static const uint8_t beq[] = { 0xf0, 0x04 };
+    static const uint8_t lda_30[] = { 0xa9, 0x30 };
+    static const uint8_t tam_40[] = { 0x53, 0x40 };
+
+    insn_push(list, 0xc000, 0x00, lda_20, 2, 0, 0);
+    insn_push(list, 0xc002, 0x00, tam_20, 2, 0, 0);
+    insn_push(list, 0xc004, 0x00, beq, 2, 0xc00a, 0x00);
+    insn_push(list, 0xc006, 0x00, lda_30, 2, 0, 0);
+    insn_push(list, 0xc008, 0x00, tam_40, 2, 0, 0);
+}
@@ -0,0 +1,30 @@
+#ifndef ETRIPATOR_TEST_INSN_H
+#define ETRIPATOR_TEST_INSN_H
+
+#include "decode.h"
+
+/**
+ * Appends an instruction to the list.
+ * \param [in,out] list        Instruction list.
+ * \param [in]     logical     Logical address.
+ * \param [in]     page        Page mapped at the logical address.
+ * \param [in]     data        Opcode followed by operands.
+ * \param [in]     size        Instruction size.
+ * \param [in]     target      Jump target logical address.
+ * \param [in]     target_page Jump target page.
+ */
+void insn_push(insn_list_t *list, uint16_t logical, uint8_t page, const uint8_t *data, uint8_t size, uint16_t target, uint8_t target_page);
+
+/**
+ * Appends the instructions of a branch skipping a memory page register update, at $c000 of page 0.
+ *      c000 lda #$20
+ *      c002 tam #$20  ; mpr5
+ *      c004 beq $c00a
+ *      c006 lda #$30
+ *      c008 tam #$40  ; mpr6
+ * The code following the branch target starts at $c00a.
+ * \param [in,out] list Instruction list.
+ */
+void insn_push_branch(insn_list_t *list);
+
+#endif // ETRIPATOR_TEST_INSN_H
@@ -26,10 +26,14 @@ void tear_down(void* fixture) {
 label_repository_t* label_repository_create();
 void label_repository_destroy(label_repository_t* repository);
 int label_repository_add(label_repository_t* repository, const char* name, uint16_t logical, uint8_t page);
+int label_repository_add_batch(label_repository_t* repository, label_address_t* addresses, size_t count);
 int label_repository_find(label_repository_t* repository, uint16_t logical, uint8_t page, char** name);
+int label_repository_find_by_name(label_repository_t* repository, const char* name, uint16_t* logical, uint8_t* page);
 int label_repository_size(label_repository_t* repository);
 int label_repository_get(label_repository_t* repository, int index, uint16_t* logical, uint8_t* page, char** name);
 int label_repository_delete(label_repository_t* repository, uint16_t first, uint16_t end, uint8_t page);
+int label_repository_seek(label_repository_t* repository, uint16_t logical, uint8_t page);
+int label_repository_next_in_range(label_repository_t* repository, int *cursor, uint32_t end, uint8_t page, uint16_t *logical, char **name);
 */
 
 MunitResult label_add_test(const MunitParameter params[], void* fixture) {
@@ -90,6 +94,8 @@ MunitResult label_delete_test(const MunitParameter params[], void* fixture) {
 
     int ret;
     char *name;
+    uint16_t logical;
+    uint8_t page;
     label_repository_t* repository;
  
     repository = label_repository_create();
@@ -144,14 +150,185 @@ MunitResult label_delete_test(const MunitParameter params[], void* fixture) {
     ret = label_repository_find(repository, 0x0550, 0x1b, &name);
     munit_assert_int(ret, ==, 0);
 
+    ret = label_repository_find_by_name(repository, "label06", &logical, &page);
+    munit_assert_int(ret, ==, 0);
+    ret = label_repository_find_by_name(repository, "label08", &logical, &page);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_int(logical, ==, 0x0557);
+    munit_assert_int(page, ==, 0x1b);
+
     label_repository_destroy(repository);    
 
     return MUNIT_OK;
 }
 
+MunitResult label_lookup_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    int ret, i;
+    char *name;
+    uint16_t logical;
+    uint8_t page;
+    char buffer[32];
+    label_repository_t* repository;
+
+    repository = label_repository_create();
+    munit_assert_not_null(repository);
+
+    for(i=0; i<20000; i++) {
+        snprintf(buffer, 32, "l%04x_%02x", (i * 3) & 0xffff, i & 0xff);
+        ret = label_repository_add(repository, buffer, (uint16_t)(i * 3), (uint8_t)i);
+        munit_assert_int(ret, !=, 0);
+    }
+    ret = label_repository_size(repository);
+    munit_assert_int(ret, ==, 20000);
+
+    for(i=0; i<20000; i++) {
+        snprintf(buffer, 32, "l%04x_%02x", (i * 3) & 0xffff, i & 0xff);
+        ret = label_repository_find(repository, (uint16_t)(i * 3), (uint8_t)i, &name);
+        munit_assert_int(ret, !=, 0);
+        munit_assert_string_equal(name, buffer);
+
+        ret = label_repository_find(repository, (uint16_t)(i * 3 + 1), (uint8_t)i, &name);
+        munit_assert_int(ret, ==, 0);
+
+        ret = label_repository_find_by_name(repository, buffer, &logical, &page);
+        munit_assert_int(ret, !=, 0);
+        munit_assert_int(logical, ==, (uint16_t)(i * 3));
+        munit_assert_int(page, ==, (uint8_t)i);
+    }
+
+    ret = label_repository_delete(repository, 0x0000, 0x8000, 0x00);
+    munit_assert_int(ret, !=, 0);
+    for(i=0; i<20000; i++) {
+        ret = label_repository_find(repository, (uint16_t)(i * 3), (uint8_t)i, &name);
+        if(((i & 0xff) == 0) && (((i * 3) & 0xffff) < 0x8000)) {
+            munit_assert_int(ret, ==, 0);
+        }
+        else {
+            munit_assert_int(ret, !=, 0);
+        }
+    }
+
+    label_repository_destroy(repository);
+    return MUNIT_OK;
+}
+
+MunitResult label_cursor_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    int ret, cursor;
+    char *name;
+    uint16_t logical;
+    uint8_t page;
+    label_repository_t* repository;
+
+    repository = label_repository_create();
+    munit_assert_not_null(repository);
+
+    ret = label_repository_add(repository, "label03", 0xe010, 0x01);
+    munit_assert_int(ret, !=, 0);
+    ret = label_repository_add(repository, "label01", 0x2000, 0x00);
+    munit_assert_int(ret, !=, 0);
+    ret = label_repository_add(repository, "label04", 0x4000, 0x02);
+    munit_assert_int(ret, !=, 0);
+    ret = label_repository_add(repository, "label02", 0xe000, 0x01);
+    munit_assert_int(ret, !=, 0);
+    ret = label_repository_add(repository, "label05", 0xffff, 0x02);
+    munit_assert_int(ret, !=, 0);
+
+    ret = label_repository_get(repository, 0, &logical, &page, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label01");
+    ret = label_repository_get(repository, 2, &logical, &page, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label03");
+    ret = label_repository_get(repository, 4, &logical, &page, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label05");
+
+    cursor = label_repository_seek(repository, 0xe001, 0x01);
+    ret = label_repository_next_in_range(repository, &cursor, 0x10000, 0x01, &logical, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_int(logical, ==, 0xe010);
+    munit_assert_string_equal(name, "label03");
+    ret = label_repository_next_in_range(repository, &cursor, 0x10000, 0x01, &logical, &name);
+    munit_assert_int(ret, ==, 0);
+
+    cursor = label_repository_seek(repository, 0x0000, 0x02);
+    ret = label_repository_next_in_range(repository, &cursor, 0x6000, 0x02, &logical, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label04");
+    ret = label_repository_next_in_range(repository, &cursor, 0x6000, 0x02, &logical, &name);
+    munit_assert_int(ret, ==, 0);
+    ret = label_repository_next_in_range(repository, &cursor, 0x10000, 0x02, &logical, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label05");
+
+    ret = label_repository_delete(repository, 0xe000, 0xe001, 0x01);
+    munit_assert_int(ret, !=, 0);
+    cursor = label_repository_seek(repository, 0xe000, 0x01);
+    ret = label_repository_next_in_range(repository, &cursor, 0x10000, 0x01, &logical, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "label03");
+
+    label_repository_destroy(repository);
+    return MUNIT_OK;
+}
+
+MunitResult label_batch_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    int ret;
+    char *name;
+    label_repository_t* repository;
+    label_address_t addresses[6] = {
+        { 0xe01a, 0x00 },
+        { 0x4000, 0x7f },
+        { 0xe01a, 0x00 },
+        { 0xc000, 0x02 },
+        { 0x4000, 0x7f },
+        { 0x2000, 0xf8 }
+    };
+
+    repository = label_repository_create();
+    munit_assert_not_null(repository);
+
+    ret = label_repository_add(repository, "main", 0xc000, 0x02);
+    munit_assert_int(ret, !=, 0);
+
+    ret = label_repository_add_batch(repository, addresses, 6);
+    munit_assert_int(ret, !=, 0);
+
+    ret = label_repository_size(repository);
+    munit_assert_int(ret, ==, 4);
+
+    ret = label_repository_find(repository, 0xe01a, 0x00, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "le01a_00");
+    ret = label_repository_find(repository, 0x4000, 0x7f, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "l4000_127");
+    ret = label_repository_find(repository, 0x2000, 0xf8, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "l2000_248");
+    ret = label_repository_find(repository, 0xc000, 0x02, &name);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_string_equal(name, "main");
+
+    label_repository_destroy(repository);
+    return MUNIT_OK;
+}
+
 static MunitTest label_tests[] = {
     { "/add", label_add_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
     { "/delete", label_delete_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/lookup", label_lookup_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/cursor", label_cursor_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/batch", label_batch_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
     { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
 
@@ -0,0 +1,78 @@
+#include <munit.h>
+#include "mpr.h"
+#include "insn.h"
+#include "message.h"
+#include "message/console.h"
+#include "message/file.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+MunitResult mpr_join_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    static const uint8_t jsr_d000[] = { 0x20, 0x00, 0xd0 };
+    static const uint8_t jsr_a000[] = { 0x20, 0x00, 0xa0 };
+    static const uint8_t rts[] = { 0x60 };
+
+    section_t code = { "code", Code, 0x00, 0xc000, 0x0000, 0x11, { 0xff, 0xf8, 0, 0, 0, 0x05, 0x06, 0 }, "code.asm", { Binary, 0, 0 } };
+
+    int ret;
+    insn_list_t list;
+    mpr_tracker_t tracker;
+
+    /* mpr5 is set on every path. mpr6 is only set when the branch is not taken,
+     * and is unknown where both paths join. */
+    memset(&list, 0, sizeof(insn_list_t));
+    insn_push_branch(&list);
+    insn_push(&list, 0xc00a, 0x00, jsr_d000, 3, 0xd000, 0x06);
+    insn_push(&list, 0xc00d, 0x00, jsr_a000, 3, 0xa000, 0x05);
+    insn_push(&list, 0xc010, 0x00, rts, 1, 0, 0);
+
+    mpr_tracker_init(&tracker);
+    ret = mpr_propagate(&tracker, &code, &list);
+    munit_assert_int(ret, ==, 1);
+    munit_assert_uint8(list.insn[5].target_page, ==, 0x06);
+    munit_assert_uint8(list.insn[6].target_page, ==, 0x20);
+
+    /* Without the branch, mpr6 is known when the subroutine is called. */
+    list.insn[2].data[0] = 0xea; /* NOP */
+    list.insn[6].target_page = 0x05;
+    ret = mpr_propagate(&tracker, &code, &list);
+    munit_assert_int(ret, ==, 2);
+    munit_assert_uint8(list.insn[5].target_page, ==, 0x30);
+    munit_assert_uint8(list.insn[6].target_page, ==, 0x20);
+
+    mpr_tracker_destroy(&tracker);
+    free(list.insn);
+    return MUNIT_OK;
+}
+
+static MunitTest mpr_tests[] = {
+    { "/join", mpr_join_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite mpr_suite = {
+    "Memory page register tracking test suite", mpr_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&mpr_suite, NULL, argc, argv);
+}
@@ -0,0 +1,213 @@
+#include <munit.h>
+#include "cd/scan.h"
+#include "message.h"
+#include "message/console.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+/* jsr $e009 (CD_READ) */
+#define SCAN_TEST_CALL 0x20, 0x09, 0xe0
+
+MunitResult scan_call_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    /* 10 records starting at record $000010 loaded in banks $80-$82 mapped by MPR 3.
+     * The leading bytes are the end of a previous instruction. */
+    static const uint8_t mpr_load[] = {
+        0xfc, 0x20,          /* (operand bytes) */
+        0x9c, 0xfc, 0x20,    /* stz $20fc  _cl */
+        0x64, 0xfd,          /* stz <$fd   _ch */
+        0xa9, 0x10,          /* lda #$10 */
+        0x85, 0xfe,          /* sta <$fe   _dl */
+        0xa2, 0x03,          /* ldx #$03 */
+        0x8e, 0xff, 0x20,    /* stx $20ff  _dh */
+        0xa0, 0x80,          /* ldy #$80 */
+        0x84, 0xfa,          /* sty <$fa   _bl */
+        0xa9, 0x0a,          /* lda #$0a */
+        0x8d, 0xf8, 0x20,    /* sta $20f8  _al */
+        SCAN_TEST_CALL
+    };
+    /* 16 records loaded at $c000. */
+    static const uint8_t local_load[] = {
+        0x62,                /* cla */
+        0x85, 0xfc,          /* sta <$fc   _cl */
+        0x85, 0xfd,          /* sta <$fd   _ch */
+        0x85, 0xfa,          /* sta <$fa   _bl */
+        0xa8,                /* tay */
+        0xa9, 0x02,          /* lda #$02 */
+        0x85, 0xfe,          /* sta <$fe   _dl */
+        0xa9, 0x01,          /* lda #$01 */
+        0x85, 0xff,          /* sta <$ff   _dh */
+        0xa9, 0xc0,          /* lda #$c0 */
+        0x85, 0xfb,          /* sta <$fb   _bh */
+        0xa9, 0x10,          /* lda #$10 */
+        0x85, 0xf8,          /* sta <$f8   _al */
+        SCAN_TEST_CALL
+    };
+    /* $0180 bytes loaded at $7f00. */
+    static const uint8_t byte_load[] = {
+        0x64, 0xfc,          /* stz <$fc   _cl */
+        0x64, 0xfd,          /* stz <$fd   _ch */
+        0x64, 0xff,          /* stz <$ff   _dh */
+        0xa9, 0x20,          /* lda #$20 */
+        0x85, 0xfe,          /* sta <$fe   _dl */
+        0x64, 0xfa,          /* stz <$fa   _bl */
+        0xa9, 0x7f,          /* lda #$7f */
+        0x85, 0xfb,          /* sta <$fb   _bh */
+        0xa9, 0x80,          /* lda #$80 */
+        0x85, 0xf8,          /* sta <$f8   _al */
+        0xa9, 0x01,          /* lda #$01 */
+        0x85, 0xf9,          /* sta <$f9   _ah */
+        SCAN_TEST_CALL
+    };
+    /* The record number is read from memory. */
+    static const uint8_t unknown_load[] = {
+        0x64, 0xfc,          /* stz <$fc   _cl */
+        0x64, 0xfd,          /* stz <$fd   _ch */
+        0xad, 0x00, 0x30,    /* lda $3000 */
+        0x85, 0xfe,          /* sta <$fe   _dl */
+        0xa9, 0x03,          /* lda #$03 */
+        0x85, 0xff,          /* sta <$ff   _dh */
+        0xa9, 0x80,          /* lda #$80 */
+        0x85, 0xfa,          /* sta <$fa   _bl */
+        0x85, 0xf8,          /* sta <$f8   _al */
+        SCAN_TEST_CALL
+    };
+    /* VRAM load. */
+    static const uint8_t vram_load[] = {
+        0x64, 0xfc,          /* stz <$fc   _cl */
+        0x64, 0xfd,          /* stz <$fd   _ch */
+        0x64, 0xfe,          /* stz <$fe   _dl */
+        0xa9, 0xff,          /* lda #$ff */
+        0x85, 0xff,          /* sta <$ff   _dh */
+        0x64, 0xfa,          /* stz <$fa   _bl */
+        0x64, 0xfb,          /* stz <$fb   _bh */
+        0xa9, 0x08,          /* lda #$08 */
+        0x85, 0xf8,          /* sta <$f8   _al */
+        SCAN_TEST_CALL
+    };
+    /* A jump between the parameters and the call. */
+    static const uint8_t jump_load[] = {
+        0x64, 0xfc,          /* stz <$fc   _cl */
+        0x64, 0xfd,          /* stz <$fd   _ch */
+        0x64, 0xfe,          /* stz <$fe   _dl */
+        0xa9, 0x03,          /* lda #$03 */
+        0x85, 0xff,          /* sta <$ff   _dh */
+        0x85, 0xfa,          /* sta <$fa   _bl */
+        0x85, 0xf8,          /* sta <$f8   _al */
+        0x80, 0x00,          /* bra */
+        SCAN_TEST_CALL
+    };
+
+    cd_overlay_t overlay;
+
+    munit_assert_int(cd_scan_call(mpr_load, sizeof(mpr_load) - 3, &overlay), ==, 1);
+    munit_assert_uint32(overlay.record, ==, 0x10);
+    munit_assert_uint8(overlay.mode, ==, 3);
+    munit_assert_uint8(overlay.bank, ==, 0x80);
+    munit_assert_uint16(overlay.logical, ==, 0x6000);
+    munit_assert_int32(overlay.size, ==, 10 * 2048);
+
+    /* 32KB from $c000 are clipped to the end of the logical address space. */
+    munit_assert_int(cd_scan_call(local_load, sizeof(local_load) - 3, &overlay), ==, 1);
+    munit_assert_uint32(overlay.record, ==, 0x02);
+    munit_assert_uint8(overlay.mode, ==, 1);
+    munit_assert_uint16(overlay.logical, ==, 0xc000);
+    munit_assert_int32(overlay.size, ==, 0x4000);
+
+    munit_assert_int(cd_scan_call(byte_load, sizeof(byte_load) - 3, &overlay), ==, 1);
+    munit_assert_uint32(overlay.record, ==, 0x20);
+    munit_assert_uint8(overlay.mode, ==, 0);
+    munit_assert_uint16(overlay.logical, ==, 0x7f00);
+    munit_assert_int32(overlay.size, ==, 0x0180);
+
+    munit_assert_int(cd_scan_call(unknown_load, sizeof(unknown_load) - 3, &overlay), ==, 0);
+    munit_assert_int(cd_scan_call(vram_load, sizeof(vram_load) - 3, &overlay), ==, 0);
+    munit_assert_int(cd_scan_call(jump_load, sizeof(jump_load) - 3, &overlay), ==, 0);
+
+    return MUNIT_OK;
+}
+
+MunitResult scan_sections_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    static const cd_overlay_t overlay[] = {
+        { 0x10, 0x6000, 3, 0x80, 10 * 2048 },
+        { 0x02, 0xc000, 1, 0x00, 0x4000 },
+        { 0x30, 0x4000, 2, 0x90, 0x2000 },
+    };
+    static const struct {
+        const char *name;
+        uint8_t page;
+        uint16_t logical;
+        uint32_t offset;
+        int32_t size;
+    } expected[] = {
+        { "overlay_000010_80_6000", 0x80, 0x6000, 0x10 * 2048, 0x2000 },
+        { "overlay_000014_81_6000", 0x81, 0x6000, 0x14 * 2048, 0x2000 },
+        { "overlay_000018_82_6000", 0x82, 0x6000, 0x18 * 2048, 0x1000 },
+        { "overlay_000002_84_c000", 0x84, 0xc000, 0x02 * 2048, 0x4000 },
+        { "overlay_000030_90_4000", 0x90, 0x4000, 0x30 * 2048, 0x2000 },
+    };
+
+    ipl_t ipl;
+    section_t *section = NULL;
+    int count = 0;
+    int i;
+
+    memset(&ipl, 0, sizeof(ipl));
+    for(i=0; i<5; i++) {
+        ipl.mpr[i] = (uint8_t)i;
+    }
+
+    munit_assert_int(cd_scan_sections(&ipl, overlay, 3, &section, &count), ==, 1);
+    munit_assert_int(count, ==, 5);
+    for(i=0; i<count; i++) {
+        munit_assert_string_equal(section[i].name, expected[i].name);
+        munit_assert_int(section[i].type, ==, Code);
+        munit_assert_uint8(section[i].page, ==, expected[i].page);
+        munit_assert_uint16(section[i].logical, ==, expected[i].logical);
+        munit_assert_uint32(section[i].offset, ==, expected[i].offset);
+        munit_assert_int32(section[i].size, ==, expected[i].size);
+        munit_assert_uint8(section[i].mpr[section[i].logical >> 13], ==, section[i].page);
+    }
+    /* Other banks keep the IPL mapping. */
+    munit_assert_uint8(section[0].mpr[2], ==, 0x80);
+    munit_assert_uint8(section[1].mpr[4], ==, 0x82);
+    munit_assert_uint8(section[4].mpr[3], ==, 0x81);
+
+    section_delete(section, count);
+    return MUNIT_OK;
+}
+
+static MunitTest scan_tests[] = {
+    { "/call", scan_call_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/sections", scan_sections_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite scan_suite = {
+    "CD overlay scan test suite", scan_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&scan_suite, NULL, argc, argv);
+}
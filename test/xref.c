@@ -0,0 +1,174 @@
+#include <munit.h>
+#include "xref.h"
+#include "message.h"
+#include "message/console.h"
+#include "message/file.h"
+
+void* setup(const MunitParameter params[], void* user_data) {
+    (void) params;
+    (void) user_data;
+
+    console_msg_printer_t *printer = (console_msg_printer_t*)malloc(sizeof(console_msg_printer_t));
+
+    msg_printer_init();
+    console_msg_printer_init(printer);
+    msg_printer_add((msg_printer_t*)printer);
+
+    return (void*)printer;
+}
+
+void tear_down(void* fixture) {
+    msg_printer_destroy();
+    free(fixture);
+}
+
+/* Checks that references are ordered by target then source address. */
+static void xref_assert_sorted(const xref_table_t *table) {
+    size_t i;
+    munit_assert_int(table->sorted, !=, 0);
+    for(i=1; i<table->count; i++) {
+        const xref_t *a = &table->entry[i-1];
+        const xref_t *b = &table->entry[i];
+        munit_assert_true((a->target < b->target) || ((a->target == b->target) && (a->source <= b->source)));
+    }
+}
+
+MunitResult xref_sort_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    static const uint32_t target[8] = {
+        0xf8e000, 0x002000, 0x01c000, 0x002000, 0xf8e000, 0x004000, 0x002000, 0x01c000
+    };
+    static const uint32_t source[8] = {
+        0x00c010, 0x00e002, 0x00e000, 0x00c020, 0x01c000, 0x00e010, 0x00c020, 0x00c000
+    };
+
+    int ret;
+    size_t i, first, count;
+    xref_table_t table;
+
+    xref_table_init(&table);
+    for(i=0; i<8; i++) {
+        ret = xref_table_push(&table, target[i], source[i], (uint8_t)(i % XrefKindCount));
+        munit_assert_int(ret, !=, 0);
+    }
+    ret = xref_table_sort(&table);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_size(table.count, ==, 8);
+    xref_assert_sorted(&table);
+
+    count = xref_table_find(&table, 0x2000, 0x00, &first);
+    munit_assert_size(count, ==, 3);
+    munit_assert_size(first, ==, 0);
+    munit_assert_uint32(table.entry[first].source, ==, 0x00c020);
+    munit_assert_uint32(table.entry[first+2].source, ==, 0x00e002);
+
+    count = xref_table_find(&table, 0xe000, 0xf8, &first);
+    munit_assert_size(count, ==, 2);
+    munit_assert_size(first, ==, 6);
+    munit_assert_uint32(table.entry[first].source, ==, 0x00c010);
+    munit_assert_uint32(table.entry[first+1].source, ==, 0x01c000);
+
+    count = xref_table_find(&table, 0x6000, 0x00, &first);
+    munit_assert_size(count, ==, 0);
+
+    xref_table_destroy(&table);
+    return MUNIT_OK;
+}
+
+MunitResult xref_stability_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    int ret;
+    size_t i;
+    xref_table_t table;
+
+    /* References with the same target and source keep their insertion order. */
+    xref_table_init(&table);
+    ret = xref_table_push(&table, 0x01c000, 0x00e000, XrefCall);
+    munit_assert_int(ret, !=, 0);
+    for(i=0; i<4; i++) {
+        ret = xref_table_push(&table, 0x002010, 0x00e100, (uint8_t)i);
+        munit_assert_int(ret, !=, 0);
+    }
+    ret = xref_table_push(&table, 0x002000, 0x00e100, XrefRead);
+    munit_assert_int(ret, !=, 0);
+
+    ret = xref_table_sort(&table);
+    munit_assert_int(ret, !=, 0);
+    xref_assert_sorted(&table);
+    munit_assert_uint32(table.entry[0].target, ==, 0x002000);
+    for(i=0; i<4; i++) {
+        munit_assert_uint32(table.entry[1+i].target, ==, 0x002010);
+        munit_assert_uint8(table.entry[1+i].kind, ==, (uint8_t)i);
+    }
+    munit_assert_uint32(table.entry[5].target, ==, 0x01c000);
+
+    xref_table_destroy(&table);
+    return MUNIT_OK;
+}
+
+MunitResult xref_skip_pass_test(const MunitParameter params[], void* fixture) {
+    (void)params;
+    (void)fixture;
+
+    int ret;
+    size_t i;
+    xref_table_t table;
+
+    /* All the references share the same source, and targets only differ by their 12 lower bits.
+     * A single radix pass is performed. */
+    xref_table_init(&table);
+    for(i=0; i<64; i++) {
+        ret = xref_table_push(&table, 0x002000 + ((i * 37) % 64), 0x00e000, XrefRead);
+        munit_assert_int(ret, !=, 0);
+    }
+    ret = xref_table_sort(&table);
+    munit_assert_int(ret, !=, 0);
+    xref_assert_sorted(&table);
+    for(i=0; i<64; i++) {
+        munit_assert_uint32(table.entry[i].target, ==, 0x002000 + i);
+    }
+
+    /* Identical keys. Every pass is skipped. */
+    xref_table_destroy(&table);
+    xref_table_init(&table);
+    for(i=0; i<16; i++) {
+        ret = xref_table_push(&table, 0x01c000, 0x00e000, (uint8_t)(i % XrefKindCount));
+        munit_assert_int(ret, !=, 0);
+    }
+    ret = xref_table_sort(&table);
+    munit_assert_int(ret, !=, 0);
+    for(i=0; i<16; i++) {
+        munit_assert_uint8(table.entry[i].kind, ==, (uint8_t)(i % XrefKindCount));
+    }
+
+    /* Adding a reference invalidates the sorted state. */
+    ret = xref_table_push(&table, 0x002000, 0x00e000, XrefWrite);
+    munit_assert_int(ret, !=, 0);
+    munit_assert_int(table.sorted, ==, 0);
+    ret = xref_table_sort(&table);
+    munit_assert_int(ret, !=, 0);
+    xref_assert_sorted(&table);
+    munit_assert_uint32(table.entry[0].target, ==, 0x002000);
+
+    xref_table_destroy(&table);
+    return MUNIT_OK;
+}
+
+static MunitTest xref_tests[] = {
+    { "/sort", xref_sort_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/stability", xref_stability_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { "/skip_pass", xref_skip_pass_test, setup, tear_down, MUNIT_TEST_OPTION_NONE, NULL },
+    { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
+};
+
+static const MunitSuite xref_suite = {
+    "Cross reference test suite", xref_tests, NULL, 1, MUNIT_SUITE_OPTION_NONE
+};
+
+int main (int argc, char* const* argv) {
+    return munit_suite_main(&xref_suite, NULL, argc, argv);
+}
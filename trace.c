@@ -0,0 +1,483 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "trace.h"
+#include "decode.h"
+#include "memory.h"
+#include "message.h"
+#include "opcodes.h"
+
+#define TRACE_BITMAP_SIZE (8192 / 8)
+
+enum {
+    TRACE_INSN = 0,     /* Bytes belonging to a decoded instruction. */
+    TRACE_START,        /* First byte of a decoded instruction. */
+    TRACE_DATA,         /* Bytes belonging to a data section. */
+    TRACE_BITMAP_COUNT
+};
+
+static inline int trace_test(const uint8_t *bitmap, int kind, uint16_t offset) {
+    return (bitmap[(kind * TRACE_BITMAP_SIZE) + (offset >> 3)] >> (offset & 7)) & 1;
+}
+
+static inline void trace_set(uint8_t *bitmap, int kind, uint16_t offset) {
+    bitmap[(kind * TRACE_BITMAP_SIZE) + (offset >> 3)] |= 1 << (offset & 7);
+}
+
+/* Retrieves page bitmaps. They are allocated on first use. */
+static uint8_t* trace_bitmap(trace_t *trace, uint8_t page) {
+    if(trace->bitmap[page] == NULL) {
+        trace->bitmap[page] = (uint8_t*)calloc(TRACE_BITMAP_COUNT, TRACE_BITMAP_SIZE);
+        if(trace->bitmap[page] == NULL) {
+            ERROR_MSG("Failed to allocate trace bitmap: %s", strerror(errno));
+        }
+    }
+    return trace->bitmap[page];
+}
+
+/* Marks data section bytes. */
+static int trace_exclude(trace_t *trace, uint8_t page, uint32_t offset, uint32_t size) {
+    while(size) {
+        uint8_t *bitmap;
+        uint32_t n = 8192 - (offset & 0x1fff);
+        if(n > size) {
+            n = size;
+        }
+        bitmap = trace_bitmap(trace, page);
+        if(bitmap == NULL) {
+            return 0;
+        }
+        for(size -= n; n; n--, offset++) {
+            trace_set(bitmap, TRACE_DATA, offset & 0x1fff);
+        }
+        page++;
+    }
+    return 1;
+}
+
+/* Marks the data sections overlapping the code reachable from the entry section. */
+static int trace_exclude_data(trace_t *trace, memmap_t *map, const section_t *section, int count, const section_t *entry) {
+    int i;
+    for(i=0; i<count; i++) {
+        const section_t *data = &section[i];
+        if((data->type != Data) || (data->size <= 0)) {
+            continue;
+        }
+        if(trace->bounded) {
+            /* Overlays share memory pages. Data sections are located through their input offset. */
+            uint32_t start = (data->offset > entry->offset) ? data->offset : entry->offset;
+            uint32_t end0 = data->offset + data->size;
+            uint32_t end1 = entry->offset + entry->size;
+            uint32_t end = (end0 < end1) ? end0 : end1;
+            if(start < end) {
+                uint16_t logical = entry->logical + (start - entry->offset);
+                if(!trace_exclude(trace, map->mpr[logical >> 13], logical, end - start)) {
+                    return 0;
+                }
+            }
+        }
+        else if(!trace->excluded) {
+            if(!trace_exclude(trace, data->page, data->logical, data->size)) {
+                return 0;
+            }
+        }
+    }
+    trace->excluded = 1;
+    return 1;
+}
+
+/* Tells if the code at the specified address can be followed from the entry section. */
+static int trace_follow(trace_t *trace, memmap_t *map, const section_t *entry, uint16_t logical) {
+    uint8_t slot = logical >> 13;
+    uint8_t entry_slot = entry->logical >> 13;
+    uint8_t page = map->mpr[slot];
+    if((page >= 0xf7) || (map->page[page] == NULL)) {
+        /* Backup RAM, RAM, I/O or unmapped page. */
+        return 0;
+    }
+    if((slot != entry_slot) && (page == map->mpr[entry_slot])) {
+        return 0;
+    }
+    if(trace->bounded && ((logical < entry->logical) || (logical >= (entry->logical + entry->size)))) {
+        return 0;
+    }
+    return 1;
+}
+
+static int trace_push(trace_t *trace, uint16_t logical) {
+    if(trace->work_count >= trace->work_capacity) {
+        size_t capacity = trace->work_capacity ? (trace->work_capacity * 2) : 256;
+        uint16_t *tmp = (uint16_t*)realloc(trace->work, capacity * sizeof(uint16_t));
+        if(tmp == NULL) {
+            ERROR_MSG("Failed to allocate trace worklist: %s", strerror(errno));
+            return 0;
+        }
+        trace->work = tmp;
+        trace->work_capacity = capacity;
+    }
+    trace->work[trace->work_count++] = logical;
+    return 1;
+}
+
+static int trace_target(trace_t *trace, uint16_t logical, uint8_t page) {
+    if(trace->target_count >= trace->target_capacity) {
+        size_t capacity = trace->target_capacity ? (trace->target_capacity * 2) : 256;
+        label_address_t *tmp = (label_address_t*)realloc(trace->target, capacity * sizeof(label_address_t));
+        if(tmp == NULL) {
+            ERROR_MSG("Failed to allocate jump targets: %s", strerror(errno));
+            return 0;
+        }
+        trace->target = tmp;
+        trace->target_capacity = capacity;
+    }
+    trace->target[trace->target_count].logical = logical;
+    trace->target[trace->target_count].page = page;
+    trace->target_count++;
+    return 1;
+}
+
+/* Records a decoded instruction. It extends the last run if it directly follows it. */
+static int trace_block_add(trace_t *trace, int owner, uint8_t slot, uint8_t page, uint16_t offset, uint16_t size) {
+    trace_block_t *block;
+    if(trace->block_count) {
+        block = &trace->block[trace->block_count - 1];
+        if((block->owner == owner) && (block->slot == slot) && (block->page == page) && ((block->offset + block->size) == offset)) {
+            block->size += size;
+            return 1;
+        }
+    }
+    if(!mem_reserve((void**)&trace->block, &trace->block_capacity, trace->block_count + 1, sizeof(trace_block_t))) {
+        return 0;
+    }
+    block = &trace->block[trace->block_count++];
+    block->owner = owner;
+    block->offset = offset;
+    block->size = size;
+    block->page = page;
+    block->slot = slot;
+    return 1;
+}
+
+/* Tells if the instruction ends the current flow (return, unconditional jump or brk). */
+static int trace_flow_end(uint8_t inst) {
+    return (inst == 0x00)    /* BRK */
+        || (inst == 0x40)    /* RTI */
+        || (inst == 0x60)    /* RTS */
+        || (inst == 0x4c)    /* JMP hhll */
+        || (inst == 0x6c)    /* JMP (hhll) */
+        || (inst == 0x7c)    /* JMP (hhll, X) */
+        || (inst == 0x80);   /* BRA */
+}
+
+/* Decodes the instructions reachable from the specified address until the flow ends. */
+static int trace_walk(trace_t *trace, memmap_t *map, const section_t *entry, int index, uint16_t logical) {
+    while(trace_follow(trace, map, entry, logical)) {
+        insn_t insn;
+        const opcode_t *opcode;
+        uint8_t page = map->mpr[logical >> 13];
+        uint16_t offset = logical & 0x1fff;
+        uint8_t *bitmap = trace_bitmap(trace, page);
+        int i;
+
+        if(bitmap == NULL) {
+            return 0;
+        }
+        if(trace_test(bitmap, TRACE_START, offset)) {
+            /* Already decoded. */
+            break;
+        }
+
+        opcode = insn_decode(&insn, map, logical);
+        if(opcode->type == PCE_unknown) {
+            INFO_MSG("Unsupported opcode %02x at %04x (%02x).", insn.data[0], logical, page);
+            break;
+        }
+        if((offset + insn.size) > 8192) {
+            /* Instructions crossing a page are left alone. */
+            break;
+        }
+        for(i=0; i<insn.size; i++) {
+            if(trace_test(bitmap, TRACE_INSN, offset + i) || trace_test(bitmap, TRACE_DATA, offset + i)) {
+                break;
+            }
+        }
+        if(i < insn.size) {
+            INFO_MSG("%04x (%02x) overlaps previously decoded code or data.", logical, page);
+            break;
+        }
+
+        if(!trace_block_add(trace, index, logical >> 13, page, offset, insn.size)) {
+            return 0;
+        }
+        for(i=0; i<insn.size; i++) {
+            trace_set(bitmap, TRACE_INSN, offset + i);
+        }
+        trace_set(bitmap, TRACE_START, offset);
+
+        if(opcode_is_local_jump(insn.data[0]) || opcode_is_far_jump(insn.data[0])) {
+            if(trace_follow(trace, map, entry, insn.target)) {
+                if(!trace_target(trace, insn.target, insn.target_page) || !trace_push(trace, insn.target)) {
+                    return 0;
+                }
+            }
+        }
+        if(trace_flow_end(insn.data[0])) {
+            break;
+        }
+        logical += insn.size;
+    }
+    return 1;
+}
+
+/* Initializes tracer. */
+void trace_init(trace_t *trace, int bounded) {
+    memset(trace, 0, sizeof(trace_t));
+    trace->bounded = bounded;
+}
+
+/* Releases tracer resources. */
+void trace_destroy(trace_t *trace) {
+    int i;
+    for(i=0; i<0x100; i++) {
+        free(trace->bitmap[i]);
+    }
+    free(trace->block);
+    free(trace->work);
+    free(trace->target);
+    memset(trace, 0, sizeof(trace_t));
+}
+
+/* Follows code from an entry section. */
+int trace_run(trace_t *trace, memmap_t *map, const section_t *section, int count, int index, label_repository_t *repository) {
+    const section_t *entry = &section[index];
+    int ret;
+
+    if(!trace_exclude_data(trace, map, section, count, entry)) {
+        return 0;
+    }
+    if(!trace_follow(trace, map, entry, entry->logical)) {
+        WARNING_MSG("%s (%04x) can not be traced.", entry->name, entry->logical);
+        return 1;
+    }
+    if(!label_repository_add(repository, entry->name, entry->logical, map->mpr[entry->logical >> 13])) {
+        return 0;
+    }
+
+    trace->work_count = 0;
+    ret = trace_push(trace, entry->logical);
+    while(ret && trace->work_count) {
+        ret = trace_walk(trace, map, entry, index, trace->work[--trace->work_count]);
+    }
+
+    ret = ret && label_repository_add_batch(repository, trace->target, trace->target_count);
+    trace->target_count = 0;
+    return ret;
+}
+
+/* Tells if an instruction was decoded at the specified address. */
+int trace_reached(trace_t *trace, memmap_t *map, uint16_t logical) {
+    const uint8_t *bitmap = trace->bitmap[map->mpr[logical >> 13]];
+    return bitmap ? trace_test(bitmap, TRACE_START, logical & 0x1fff) : 0;
+}
+
+/* Creates a code section for a run of decoded instructions. */
+static int trace_section_add(trace_t *trace, const trace_block_t *block, section_t **section, int *count, label_repository_t *repository) {
+    section_t *tmp, *out;
+    const section_t *entry;
+    char *label;
+    char name[32];
+    uint8_t page = block->page;
+    uint16_t logical = (block->slot << 13) | block->offset;
+
+    tmp = (section_t*)realloc(*section, (*count + 1) * sizeof(section_t));
+    if(tmp == NULL) {
+        ERROR_MSG("Failed to allocate sections: %s", strerror(errno));
+        return 0;
+    }
+    *section = tmp;
+    out = &tmp[*count];
+    entry = &tmp[block->owner];
+
+    if(!label_repository_find(repository, logical, page, &label)) {
+        snprintf(name, sizeof(name), "code_%02x_%04x", page, logical);
+        label = name;
+    }
+    section_reset(out);
+    out->name = strdup(label);
+    out->type = Code;
+    out->page = page;
+    out->logical = logical;
+    out->size = block->size;
+    out->offset = trace->bounded ? (uint32_t)(entry->offset + (logical - entry->logical)) : (uint32_t)((page << 13) | block->offset);
+    memcpy(out->mpr, entry->mpr, 8);
+    out->output = strdup(entry->output);
+    if((out->name == NULL) || (out->output == NULL)) {
+        ERROR_MSG("Failed to allocate section: %s", strerror(errno));
+        free(out->name);
+        free(out->output);
+        return 0;
+    }
+    (*count)++;
+    return 1;
+}
+
+/* Orders runs by page and offset. */
+static int trace_block_compare(const void *a, const void *b) {
+    const trace_block_t *b0 = (const trace_block_t*)a;
+    const trace_block_t *b1 = (const trace_block_t*)b;
+    if(b0->page != b1->page) {
+        return b0->page - b1->page;
+    }
+    return b0->offset - b1->offset;
+}
+
+/* Creates code sections and resets the tracer. */
+int trace_collect(trace_t *trace, section_t **section, int *count, label_repository_t *repository) {
+    size_t i, j;
+    int page;
+
+    /* Merge the runs following each other that were decoded from the same entry through the same mpr. */
+    qsort(trace->block, trace->block_count, sizeof(trace_block_t), trace_block_compare);
+    for(i=0, j=0; i<trace->block_count; i++) {
+        trace_block_t *block = &trace->block[i];
+        if(j) {
+            trace_block_t *last = &trace->block[j-1];
+            if((last->owner == block->owner) && (last->slot == block->slot) && (last->page == block->page) && ((last->offset + last->size) == block->offset)) {
+                last->size += block->size;
+                continue;
+            }
+        }
+        trace->block[j++] = *block;
+    }
+    for(i=0; i<j; i++) {
+        if(!trace_section_add(trace, &trace->block[i], section, count, repository)) {
+            return 0;
+        }
+    }
+    trace->block_count = 0;
+
+    for(page=0; page<0x100; page++) {
+        if(trace->bitmap[page]) {
+            memset(trace->bitmap[page], 0, TRACE_BITMAP_COUNT * TRACE_BITMAP_SIZE);
+        }
+    }
+    trace->excluded = 0;
+    return 1;
+}
+
+/* Marks the bytes of the entry section which belong to another section. */
+static void trace_cover(uint8_t *covered, const section_t *entry, const section_t *other, int bounded) {
+    uint32_t start, end, i;
+    if(other->size <= 0) {
+        return;
+    }
+    if(bounded) {
+        /* Overlays share memory pages. Sections are located through their input offset. */
+        start = (other->offset > entry->offset) ? other->offset : entry->offset;
+        end = ((other->offset + other->size) < (entry->offset + entry->size)) ? (other->offset + other->size) : (entry->offset + entry->size);
+        for(i=start; i<end; i++) {
+            covered[i - entry->offset] = 1;
+        }
+        return;
+    }
+    start = (other->logical > entry->logical) ? other->logical : entry->logical;
+    end = ((other->logical + other->size) < (entry->logical + entry->size)) ? (other->logical + other->size) : (entry->logical + entry->size);
+    for(i=start; i<end; i++) {
+        /* Sections spanning several 8KB windows are mapped to consecutive pages. */
+        uint32_t page0 = entry->page + ((i - (entry->logical & 0xe000)) >> 13);
+        uint32_t page1 = other->page + ((i - (other->logical & 0xe000)) >> 13);
+        if(page0 == page1) {
+            covered[i - entry->logical] = 1;
+        }
+    }
+}
+
+/* Creates data sections for the bytes of an entry section that were not reached. */
+int trace_remainder(trace_t *trace, section_t **section, int *count, int index, int first, int last, label_repository_t *repository) {
+    uint8_t *covered;
+    section_t entry;
+    int32_t offset, end;
+    int i;
+
+    entry = (*section)[index];
+    if(entry.size <= 0) {
+        return 1;
+    }
+    covered = (uint8_t*)calloc(entry.size, 1);
+    if(covered == NULL) {
+        ERROR_MSG("Failed to allocate trace remainder: %s", strerror(errno));
+        return 0;
+    }
+    for(i=first; i<last; i++) {
+        trace_cover(covered, &entry, &(*section)[i], trace->bounded);
+    }
+    for(i=0; i<first; i++) {
+        if((*section)[i].type == Data) {
+            trace_cover(covered, &entry, &(*section)[i], trace->bounded);
+        }
+    }
+
+    for(offset=0; offset<entry.size; offset=end) {
+        section_t *tmp, *out;
+        uint16_t logical;
+        uint8_t page;
+        char *label;
+        char name[32];
+        for(end=offset+1; (end < entry.size) && (covered[end] == covered[offset]); end++) {
+        }
+        if(covered[offset]) {
+            continue;
+        }
+        tmp = (section_t*)realloc(*section, (*count + 1) * sizeof(section_t));
+        if(tmp == NULL) {
+            ERROR_MSG("Failed to allocate sections: %s", strerror(errno));
+            free(covered);
+            return 0;
+        }
+        *section = tmp;
+        out = &tmp[*count];
+        logical = (uint16_t)(entry.logical + offset);
+        page = (uint8_t)(entry.page + ((logical - (entry.logical & 0xe000)) >> 13));
+        if(!label_repository_find(repository, logical, page, &label)) {
+            snprintf(name, sizeof(name), "data_%02x_%04x", page, logical);
+            label = name;
+        }
+        section_reset(out);
+        out->name = strdup(label);
+        out->type = Data;
+        out->data.type = Hex;
+        out->data.element_size = 1;
+        out->data.elements_per_line = 16;
+        out->page = page;
+        out->logical = logical;
+        out->size = end - offset;
+        out->offset = trace->bounded ? (uint32_t)(entry.offset + offset) : (uint32_t)((page << 13) | (logical & 0x1fff));
+        memcpy(out->mpr, entry.mpr, 8);
+        out->output = strdup(entry.output);
+        if((out->name == NULL) || (out->output == NULL)) {
+            ERROR_MSG("Failed to allocate section: %s", strerror(errno));
+            free(out->name);
+            free(out->output);
+            free(covered);
+            return 0;
+        }
+        INFO_MSG("%s: %d bytes at %02x:%04x were not reached and are kept as data.", entry.name, out->size, page, logical);
+        (*count)++;
+    }
+    free(covered);
+    return 1;
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_TRACE_H
+#define ETRIPATOR_TRACE_H
+
+#include "config.h"
+#include "label.h"
+#include "section.h"
+#include "memorymap.h"
+
+/**
+ * Run of consecutive instructions decoded from the same entry section through the same mpr.
+ */
+typedef struct {
+    int owner;        /**< Index of the entry section. **/
+    uint16_t offset;  /**< Offset of the first instruction in the page. **/
+    uint16_t size;    /**< Size (in bytes). **/
+    uint8_t page;     /**< Memory page. **/
+    uint8_t slot;     /**< Index of the mpr the page was reached through. **/
+} trace_block_t;
+
+/**
+ * Control flow tracer.
+ * Code is followed from entry points through jumps, branches and subroutine calls.
+ * Each memory page has bitmaps of the bytes already decoded, so that every instruction is only decoded once.
+ */
+typedef struct {
+    uint8_t *bitmap[0x100];   /**< Per page bitmaps (instruction bytes, instruction starts and data bytes). **/
+    trace_block_t *block;     /**< Decoded instruction runs. **/
+    size_t block_count;
+    size_t block_capacity;
+    int bounded;              /**< Only follow code inside the entry sections (CDROM). **/
+    int excluded;             /**< Set when data sections were marked. **/
+    uint16_t *work;           /**< Addresses left to decode. **/
+    size_t work_count;
+    size_t work_capacity;
+    label_address_t *target;  /**< Jump targets. **/
+    size_t target_count;
+    size_t target_capacity;
+} trace_t;
+
+/**
+ * Initializes tracer.
+ * \param [out] trace   Tracer.
+ * \param [in]  bounded If set, code is only followed inside the data loaded for the entry section (CDROM overlays).
+ *                      Otherwise any mapped ROM page can be reached.
+ */
+void trace_init(trace_t *trace, int bounded);
+
+/**
+ * Releases tracer resources.
+ * \param [in,out] trace Tracer.
+ */
+void trace_destroy(trace_t *trace);
+
+/**
+ * Follows code from an entry section.
+ * Data sections are never decoded. The entry name and every jump target found are added to the label repository.
+ * Targets mapped to RAM or I/O pages are not followed. A target in another mpr holding the same page as the entry
+ * mpr is not followed either, as the actual bank is unknown.
+ * \param [in,out] trace      Tracer.
+ * \param [in]     map        Memory map. The mprs must be set to the entry section ones.
+ * \param [in]     section    Sections.
+ * \param [in]     count      Number of sections.
+ * \param [in]     index      Index of the entry section.
+ * \param [in,out] repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int trace_run(trace_t *trace, memmap_t *map, const section_t *section, int count, int index, label_repository_t *repository);
+
+/**
+ * Tells if an instruction was decoded at the specified address.
+ * \param [in] trace   Tracer.
+ * \param [in] map     Memory map.
+ * \param [in] logical Logical address.
+ * \return 1 if an instruction starts at this address, 0 otherwise.
+ */
+int trace_reached(trace_t *trace, memmap_t *map, uint16_t logical);
+
+/**
+ * Creates a code section for each contiguous run of instructions decoded from the same entry section through the
+ * same mpr, and resets the tracer.
+ * Sections are named after the label at their start address. They are written to the output file of the entry
+ * section which decoded them.
+ * \param [in,out] trace      Tracer.
+ * \param [in,out] section    Sections. New sections are appended.
+ * \param [in,out] count      Number of sections.
+ * \param [in]     repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int trace_collect(trace_t *trace, section_t **section, int *count, label_repository_t *repository);
+
+/**
+ * Creates a data section for each run of bytes of an entry section that belongs neither to the code traced
+ * from it nor to a data section. Entry sections without an explicit size are left untouched.
+ * \param [in]     trace      Tracer.
+ * \param [in,out] section    Sections. New sections are appended.
+ * \param [in,out] count      Number of sections.
+ * \param [in]     index      Index of the entry section.
+ * \param [in]     first      Index of the first code section created by trace_collect.
+ * \param [in]     last       Index following the last code section created by trace_collect.
+ * \param [in]     repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int trace_remainder(trace_t *trace, section_t **section, int *count, int index, int first, int last, label_repository_t *repository);
+
+#endif // ETRIPATOR_TRACE_H
@@ -0,0 +1,157 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "xref.h"
+#include "message.h"
+#include "memory.h"
+
+#define XREF_RADIX_BITS 12
+#define XREF_RADIX_SIZE (1 << XREF_RADIX_BITS)
+#define XREF_RADIX_PASSES 4
+
+/* Sort key. Both addresses are 24 bits wide. */
+static inline uint64_t xref_key(const xref_t *xref) {
+    return ((uint64_t)xref->target << 24) | (xref->source & 0xffffff);
+}
+
+/* Initializes cross reference table. */
+void xref_table_init(xref_table_t *table) {
+    memset(table, 0, sizeof(xref_table_t));
+}
+
+/* Releases cross reference table resources. */
+void xref_table_destroy(xref_table_t *table) {
+    free(table->entry);
+    memset(table, 0, sizeof(xref_table_t));
+}
+
+/* Appends a reference. */
+int xref_table_push(xref_table_t *table, uint32_t target, uint32_t source, uint8_t kind) {
+    xref_t *xref;
+    if(!mem_reserve((void**)&table->entry, &table->capacity, table->count + 1, sizeof(xref_t))) {
+        return 0;
+    }
+    xref = &table->entry[table->count++];
+    xref->target = target;
+    xref->source = source;
+    xref->kind = kind;
+    table->sorted = 0;
+    return 1;
+}
+
+/* Sorts references by target and source address. */
+int xref_table_sort(xref_table_t *table) {
+    uint32_t *histogram;
+    xref_t *src, *dst, *tmp;
+    size_t i;
+    int pass;
+
+    if(table->sorted || (table->count < 2)) {
+        table->sorted = 1;
+        return 1;
+    }
+
+    /* LSD radix sort. Entries with the same key keep their insertion order. */
+    histogram = (uint32_t*)calloc(XREF_RADIX_PASSES * XREF_RADIX_SIZE, sizeof(uint32_t));
+    tmp = (xref_t*)malloc(table->count * sizeof(xref_t));
+    if((histogram == NULL) || (tmp == NULL)) {
+        ERROR_MSG("Failed to sort cross references: %s", strerror(errno));
+        free(histogram);
+        free(tmp);
+        return 0;
+    }
+    for(i=0; i<table->count; i++) {
+        uint64_t key = xref_key(&table->entry[i]);
+        for(pass=0; pass<XREF_RADIX_PASSES; pass++) {
+            histogram[(pass * XREF_RADIX_SIZE) + ((key >> (pass * XREF_RADIX_BITS)) & (XREF_RADIX_SIZE - 1))]++;
+        }
+    }
+
+    src = table->entry;
+    dst = tmp;
+    for(pass=0; pass<XREF_RADIX_PASSES; pass++) {
+        uint32_t *count = histogram + (pass * XREF_RADIX_SIZE);
+        uint32_t offset = 0;
+        int shift = pass * XREF_RADIX_BITS;
+        /* Skip digits shared by all the entries. */
+        if(count[(xref_key(&src[0]) >> shift) & (XREF_RADIX_SIZE - 1)] == table->count) {
+            continue;
+        }
+        for(i=0; i<XREF_RADIX_SIZE; i++) {
+            uint32_t n = count[i];
+            count[i] = offset;
+            offset += n;
+        }
+        for(i=0; i<table->count; i++) {
+            dst[count[(xref_key(&src[i]) >> shift) & (XREF_RADIX_SIZE - 1)]++] = src[i];
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if(src != table->entry) {
+        memcpy(table->entry, src, table->count * sizeof(xref_t));
+    }
+    free((src == table->entry) ? dst : src);
+    free(histogram);
+    table->sorted = 1;
+    return 1;
+}
+
+/* Finds the references to an address. */
+size_t xref_table_find(const xref_table_t *table, uint16_t logical, uint8_t page, size_t *first) {
+    uint32_t target = xref_address(logical, page);
+    size_t lo = 0, hi = table->count, end;
+    while(lo < hi) {
+        size_t middle = lo + (hi - lo) / 2;
+        if(table->entry[middle].target < target) {
+            lo = middle + 1;
+        }
+        else {
+            hi = middle;
+        }
+    }
+    for(end=lo; (end < table->count) && (table->entry[end].target == target); end++) {
+    }
+    *first = lo;
+    return end - lo;
+}
+
+/* Initializes label definition list. */
+void xref_label_list_init(xref_label_list_t *list) {
+    memset(list, 0, sizeof(xref_label_list_t));
+}
+
+/* Releases label definition list resources. */
+void xref_label_list_destroy(xref_label_list_t *list) {
+    free(list->entry);
+    memset(list, 0, sizeof(xref_label_list_t));
+}
+
+/* Appends a label definition of the current output file. */
+int xref_label_list_push(xref_label_list_t *list, uint64_t offset, uint16_t logical, uint8_t page) {
+    xref_label_t *label;
+    if(!mem_reserve((void**)&list->entry, &list->capacity, list->count + 1, sizeof(xref_label_t))) {
+        list->error = 1;
+        return 0;
+    }
+    label = &list->entry[list->count++];
+    label->offset = offset;
+    label->address = xref_address(logical, page);
+    label->file = list->file;
+    return 1;
+}
@@ -0,0 +1,149 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_XREF_H
+#define ETRIPATOR_XREF_H
+
+#include "config.h"
+
+/**
+ * Reference kind.
+ */
+typedef enum {
+    XrefRead = 0,    /**< Memory read (including indirect pointers). **/
+    XrefWrite,       /**< Memory write (sta, stx, sty, stz, block transfer destination). **/
+    XrefModify,      /**< Read-modify-write (inc, dec, shifts, rotations, bit set/reset). **/
+    XrefJump,        /**< Jump or branch. **/
+    XrefCall,        /**< Subroutine call (jsr, bsr). **/
+    XrefKindCount
+} xref_kind_t;
+
+/**
+ * Cross reference.
+ * Addresses are stored as (page << 16) | logical.
+ */
+typedef struct {
+    uint32_t target;  /**< Referenced address. **/
+    uint32_t source;  /**< Address of the referencing instruction. **/
+    uint8_t kind;     /**< Reference kind (see xref_kind_t). **/
+} xref_t;
+
+/**
+ * Cross reference table.
+ * References are appended as instructions are decoded, then sorted by target and source address
+ * so that all the references to an address are contiguous.
+ */
+typedef struct {
+    xref_t *entry;
+    size_t count;
+    size_t capacity;
+    int sorted;       /**< Set once the table is sorted. **/
+} xref_table_t;
+
+/**
+ * Label definition waiting for its reference count.
+ */
+typedef struct {
+    uint64_t offset;  /**< Output file offset right after the label definition. **/
+    uint32_t address; /**< Label address. **/
+    uint32_t file;    /**< Output file id. **/
+} xref_label_t;
+
+/**
+ * Label definitions to annotate once the references of all the code sections are known.
+ */
+typedef struct {
+    xref_label_t *entry;
+    size_t count;
+    size_t capacity;
+    uint32_t file;    /**< Id of the current output file. **/
+    int error;        /**< Set if a label could not be recorded. **/
+} xref_label_list_t;
+
+/**
+ * Builds a cross reference address.
+ * \param [in] logical Logical address.
+ * \param [in] page    Memory page.
+ * \return Cross reference address.
+ */
+static inline uint32_t xref_address(uint16_t logical, uint8_t page) {
+    return ((uint32_t)page << 16) | logical;
+}
+
+/**
+ * Initializes cross reference table.
+ * \param [out] table Cross reference table.
+ */
+void xref_table_init(xref_table_t *table);
+
+/**
+ * Releases cross reference table resources.
+ * \param [in,out] table Cross reference table.
+ */
+void xref_table_destroy(xref_table_t *table);
+
+/**
+ * Appends a reference.
+ * \param [in,out] table  Cross reference table.
+ * \param [in]     target Referenced address.
+ * \param [in]     source Address of the referencing instruction.
+ * \param [in]     kind   Reference kind (see xref_kind_t).
+ * \return 1 upon success, 0 if an error occured.
+ */
+int xref_table_push(xref_table_t *table, uint32_t target, uint32_t source, uint8_t kind);
+
+/**
+ * Sorts references by target and source address.
+ * References with the same target and source keep their insertion order.
+ * \param [in,out] table Cross reference table.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int xref_table_sort(xref_table_t *table);
+
+/**
+ * Finds the references to an address. The table must be sorted.
+ * \param [in]  table   Cross reference table.
+ * \param [in]  logical Logical address.
+ * \param [in]  page    Memory page.
+ * \param [out] first   Index of the first reference.
+ * \return Number of references.
+ */
+size_t xref_table_find(const xref_table_t *table, uint16_t logical, uint8_t page, size_t *first);
+
+/**
+ * Initializes label definition list.
+ * \param [out] list Label definition list.
+ */
+void xref_label_list_init(xref_label_list_t *list);
+
+/**
+ * Releases label definition list resources.
+ * \param [in,out] list Label definition list.
+ */
+void xref_label_list_destroy(xref_label_list_t *list);
+
+/**
+ * Appends a label definition of the current output file.
+ * \param [in,out] list    Label definition list.
+ * \param [in]     offset  Output file offset right after the label definition.
+ * \param [in]     logical Logical address.
+ * \param [in]     page    Memory page.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int xref_label_list_push(xref_label_list_t *list, uint64_t offset, uint16_t logical, uint8_t page);
+
+#endif // ETRIPATOR_XREF_H
@@ -0,0 +1,143 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <errno.h>
+#include <string.h>
+
+#include "save.h"
+#include "../emitter.h"
+#include "../message.h"
+
+static const char *xref_kind_name[XrefKindCount] = {
+    "read", "write", "modify", "jump", "call"
+};
+
+/* Appends the logical address and page of a reference address. */
+static void xref_write_address(emitter_t *out, uint32_t address) {
+    emitter_string(out, "\"logical\":\"");
+    emitter_hex16(out, (uint16_t)address);
+    emitter_string(out, "\", \"page\":\"");
+    emitter_hex8(out, (uint8_t)(address >> 16));
+    emitter_char(out, '"');
+}
+
+/* Cross reference table output. */
+typedef struct {
+    const xref_table_t *table;
+    label_repository_t *repository;
+} xref_table_output_t;
+
+static void xref_table_write(emitter_t *out, const void *data) {
+    const xref_table_t *table = ((const xref_table_output_t*)data)->table;
+    label_repository_t *repository = ((const xref_table_output_t*)data)->repository;
+    size_t i, j;
+    emitter_string(out, "[\n");
+    for(i=0; i<table->count; i=j) {
+        uint32_t target = table->entry[i].target;
+        char *name = NULL;
+        emitter_string(out, "\t{ ");
+        xref_write_address(out, target);
+        if(label_repository_find(repository, (uint16_t)target, (uint8_t)(target >> 16), &name)) {
+            emitter_string(out, ", \"label\":\"");
+            emitter_string(out, name);
+            emitter_char(out, '"');
+        }
+        emitter_string(out, ", \"references\":[ ");
+        for(j=i; (j<table->count) && (table->entry[j].target == target); j++) {
+            emitter_string(out, (j != i) ? ", { " : "{ ");
+            xref_write_address(out, table->entry[j].source);
+            emitter_string(out, ", \"kind\":\"");
+            emitter_string(out, xref_kind_name[table->entry[j].kind]);
+            emitter_string(out, "\" }");
+        }
+        emitter_string(out, (j < table->count) ? " ] },\n" : " ] }\n");
+    }
+    emitter_string(out, "]\n");
+}
+
+/* Save cross reference table as a JSON file. */
+int xref_table_save(const char *filename, const xref_table_t *table, label_repository_t *repository) {
+    xref_table_output_t output = { table, repository };
+    return emitter_save(filename, xref_table_write, &output);
+}
+
+/* Insert the reference count of the labels defined in an output file. */
+int xref_annotate(const char *filename, const xref_label_list_t *labels, uint32_t file, const xref_table_t *table) {
+    emitter_t out;
+    FILE *stream;
+    char *text;
+    size_t i, first, pos, len;
+    long start, end;
+    int ret;
+
+    for(first=0; (first<labels->count) && (labels->entry[first].file != file); first++) {
+    }
+    if(first >= labels->count) {
+        return 1;
+    }
+    stream = fopen(filename, "r+b");
+    if(stream == NULL) {
+        ERROR_MSG("Failed to open %s: %s", filename, strerror(errno));
+        return 0;
+    }
+    /* Only the text following the first label definition is read and written back. */
+    start = (long)labels->entry[first].offset;
+    if(fseek(stream, 0, SEEK_END) || ((end = ftell(stream)) < start) || fseek(stream, start, SEEK_SET)) {
+        ERROR_MSG("Failed to seek %s: %s", filename, strerror(errno));
+        fclose(stream);
+        return 0;
+    }
+    len = (size_t)(end - start);
+    text = (char*)malloc(len + 1);
+    if(text == NULL) {
+        ERROR_MSG("Failed to allocate %s content: %s", filename, strerror(errno));
+        fclose(stream);
+        return 0;
+    }
+    if((fread(text, 1, len, stream) != len) || fseek(stream, start, SEEK_SET)) {
+        ERROR_MSG("Failed to read %s: %s", filename, strerror(errno));
+        free(text);
+        fclose(stream);
+        return 0;
+    }
+
+    memset(&out, 0, sizeof(emitter_t));
+    ret = emitter_init(&out);
+    if(ret) {
+        emitter_reset(&out, stream);
+        for(i=first, pos=0; i<labels->count; i++) {
+            const xref_label_t *label = &labels->entry[i];
+            size_t offset, dummy;
+            if(label->file != file) {
+                continue;
+            }
+            offset = (size_t)(label->offset - (uint64_t)start);
+            emitter_write(&out, text + pos, offset - pos);
+            emitter_printf(&out, "\t; %zu reference(s)", xref_table_find(table, (uint16_t)label->address, (uint8_t)(label->address >> 16), &dummy));
+            pos = offset;
+        }
+        emitter_write(&out, text + pos, len - pos);
+        ret = emitter_flush(&out);
+        emitter_destroy(&out);
+    }
+    if(fclose(stream)) {
+        ERROR_MSG("Failed to write %s: %s", filename, strerror(errno));
+        ret = 0;
+    }
+    free(text);
+    return ret;
+}
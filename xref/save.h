@@ -0,0 +1,44 @@
+/*
+    This file is part of Etripator,
+    copyright (c) 2009--2021 Vincent Cruz.
+
+    Etripator is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Etripator is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Etripator.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ETRIPATOR_XREF_SAVE_H
+#define ETRIPATOR_XREF_SAVE_H
+
+#include "../xref.h"
+#include "../label.h"
+
+/**
+ * Save cross reference table as a JSON file.
+ * References are grouped by target address.
+ * \param [in] filename   Output filename.
+ * \param [in] table      Sorted cross reference table.
+ * \param [in] repository Label repository.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int xref_table_save(const char *filename, const xref_table_t *table, label_repository_t *repository);
+
+/**
+ * Insert the reference count of the labels defined in an output file right after their definition.
+ * \param [in] filename Output filename.
+ * \param [in] labels   Label definitions.
+ * \param [in] file     Id of the output file. Only the label definitions with this id are annotated.
+ * \param [in] table    Sorted cross reference table.
+ * \return 1 upon success, 0 if an error occured.
+ */
+int xref_annotate(const char *filename, const xref_label_list_t *labels, uint32_t file, const xref_table_t *table);
+
+#endif // ETRIPATOR_XREF_SAVE_H